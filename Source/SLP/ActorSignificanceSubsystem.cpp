@@ -0,0 +1,204 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ActorSignificanceSubsystem.h"
+
+#include "SLP.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/IConsoleManager.h"
+
+DECLARE_CYCLE_STAT(TEXT("Significance Update"), STAT_SignificanceUpdate, STATGROUP_SLP);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Significance High"), STAT_SignificanceHigh, STATGROUP_SLP);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Significance Medium"), STAT_SignificanceMedium, STATGROUP_SLP);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Significance Low"), STAT_SignificanceLow, STATGROUP_SLP);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Significance Dormant"), STAT_SignificanceDormant, STATGROUP_SLP);
+
+static TAutoConsoleVariable<float> CVarSignificanceUpdateInterval(
+	TEXT("slp.Significance.UpdateInterval"), 0.25f,
+	TEXT("Seconds between significance updates."));
+
+static TAutoConsoleVariable<float> CVarSignificanceHighDistance(
+	TEXT("slp.Significance.HighDistance"), 2000.f,
+	TEXT("Distance to the nearest player viewpoint below which actors tick every frame."));
+
+static TAutoConsoleVariable<float> CVarSignificanceMediumDistance(
+	TEXT("slp.Significance.MediumDistance"), 5000.f,
+	TEXT("Distance to the nearest player viewpoint below which actors use the medium tick interval."));
+
+static TAutoConsoleVariable<float> CVarSignificanceLowDistance(
+	TEXT("slp.Significance.LowDistance"), 10000.f,
+	TEXT("Distance to the nearest player viewpoint below which actors use the low tick interval. Further actors go dormant."));
+
+static TAutoConsoleVariable<float> CVarSignificanceHysteresis(
+	TEXT("slp.Significance.Hysteresis"), 0.1f,
+	TEXT("Fraction of a bucket distance an actor has to cross before it changes bucket."));
+
+static TAutoConsoleVariable<float> CVarSignificanceMediumTickInterval(
+	TEXT("slp.Significance.MediumTickInterval"), 0.1f,
+	TEXT("Tick interval for actors in the medium bucket."));
+
+static TAutoConsoleVariable<float> CVarSignificanceLowTickInterval(
+	TEXT("slp.Significance.LowTickInterval"), 0.5f,
+	TEXT("Tick interval for actors in the low bucket."));
+
+bool UActorSignificanceSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game or WorldType == EWorldType::PIE;
+}
+
+TStatId UActorSignificanceSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UActorSignificanceSubsystem, STATGROUP_Tickables);
+}
+
+void UActorSignificanceSubsystem::RegisterActor(AActor* Actor, bool bCanDisableTick)
+{
+	LLM_SCOPE_BYTAG(SLP);
+
+	if(!Actor) return;
+
+	FSignificanceEntry& Entry = Entries.AddDefaulted_GetRef();
+	Entry.Actor = Actor;
+	Entry.bCanDisableTick = bCanDisableTick;
+
+	// score right away so actors spawned far from the players don't tick until the next update
+	GatherViewpoints();
+	if(Viewpoints.IsEmpty()) return;
+
+	float MinDistanceSquared = TNumericLimits<float>::Max();
+	for(const FVector& Viewpoint : Viewpoints)
+	{
+		MinDistanceSquared = FMath::Min(MinDistanceSquared, FVector::DistSquared(Viewpoint, Actor -> GetActorLocation()));
+	}
+	ApplyBucket(Entry, ScoreBucket(MinDistanceSquared, Entry.Bucket));
+}
+
+void UActorSignificanceSubsystem::UnregisterActor(AActor* Actor)
+{
+	Entries.RemoveAllSwap([Actor](const FSignificanceEntry& Entry)
+	{
+		return Entry.Actor == Actor;
+	});
+}
+
+ESignificanceBucket UActorSignificanceSubsystem::GetBucket(const AActor* Actor) const
+{
+	for(const FSignificanceEntry& Entry : Entries)
+	{
+		if(Entry.Actor == Actor) return Entry.Bucket;
+	}
+	return ESignificanceBucket::High;
+}
+
+void UActorSignificanceSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	TimeSinceUpdate += DeltaTime;
+	if(TimeSinceUpdate < CVarSignificanceUpdateInterval.GetValueOnGameThread()) return;
+	TimeSinceUpdate = 0.f;
+
+	UpdateSignificance();
+}
+
+void UActorSignificanceSubsystem::GatherViewpoints()
+{
+	Viewpoints.Reset();
+	for(FConstPlayerControllerIterator It = GetWorld() -> GetPlayerControllerIterator(); It; ++It)
+	{
+		const APlayerController* PlayerController = It -> Get();
+		if(!PlayerController) continue;
+
+		FVector ViewLocation;
+		FRotator ViewRotation;
+		PlayerController -> GetPlayerViewPoint(ViewLocation, ViewRotation);
+		Viewpoints.Add(ViewLocation);
+	}
+}
+
+void UActorSignificanceSubsystem::UpdateSignificance()
+{
+	SCOPE_CYCLE_COUNTER(STAT_SignificanceUpdate);
+
+	GatherViewpoints();
+	if(Viewpoints.IsEmpty()) return;	// no players yet, leave everything as it is
+
+	int32 Population[(int32)ESignificanceBucket::Num] = {};
+
+	for(int32 Index = Entries.Num() - 1; Index >= 0; --Index)
+	{
+		FSignificanceEntry& Entry = Entries[Index];
+		AActor* Actor = Entry.Actor.Get();
+		if(!Actor)
+		{
+			Entries.RemoveAtSwap(Index);
+			continue;
+		}
+
+		// the nearest player decides how significant the actor is
+		const FVector ActorLocation = Actor -> GetActorLocation();
+		float MinDistanceSquared = TNumericLimits<float>::Max();
+		for(const FVector& Viewpoint : Viewpoints)
+		{
+			MinDistanceSquared = FMath::Min(MinDistanceSquared, FVector::DistSquared(Viewpoint, ActorLocation));
+		}
+
+		ApplyBucket(Entry, ScoreBucket(MinDistanceSquared, Entry.Bucket));
+		++Population[(int32)Entry.Bucket];
+	}
+
+	SET_DWORD_STAT(STAT_SignificanceHigh, Population[(int32)ESignificanceBucket::High]);
+	SET_DWORD_STAT(STAT_SignificanceMedium, Population[(int32)ESignificanceBucket::Medium]);
+	SET_DWORD_STAT(STAT_SignificanceLow, Population[(int32)ESignificanceBucket::Low]);
+	SET_DWORD_STAT(STAT_SignificanceDormant, Population[(int32)ESignificanceBucket::Dormant]);
+}
+
+ESignificanceBucket UActorSignificanceSubsystem::ScoreBucket(float DistanceSquared, ESignificanceBucket CurrentBucket) const
+{
+	const float BucketDistances[] = {
+		CVarSignificanceHighDistance.GetValueOnGameThread(),
+		CVarSignificanceMediumDistance.GetValueOnGameThread(),
+		CVarSignificanceLowDistance.GetValueOnGameThread()
+	};
+	const float Hysteresis = CVarSignificanceHysteresis.GetValueOnGameThread();
+
+	int32 NewBucket = 0;
+	for(int32 Boundary = 0; Boundary < UE_ARRAY_COUNT(BucketDistances); ++Boundary)
+	{
+		// the boundary is pushed away from the side the actor is currently on, so it has to cross it by a margin
+		const float Scale = (int32)CurrentBucket > Boundary ? 1.f - Hysteresis : 1.f + Hysteresis;
+		if(DistanceSquared <= FMath::Square(BucketDistances[Boundary] * Scale)) break;
+		NewBucket = Boundary + 1;
+	}
+	return (ESignificanceBucket)NewBucket;
+}
+
+void UActorSignificanceSubsystem::ApplyBucket(FSignificanceEntry& Entry, ESignificanceBucket NewBucket)
+{
+	if(!Entry.bCanDisableTick and NewBucket == ESignificanceBucket::Dormant) NewBucket = ESignificanceBucket::Low;
+	if(Entry.Bucket == NewBucket) return;
+	Entry.Bucket = NewBucket;
+
+	AActor* Actor = Entry.Actor.Get();
+	switch(NewBucket)
+	{
+		case ESignificanceBucket::High:
+			Actor -> SetActorTickInterval(0.f);
+			Actor -> SetActorTickEnabled(true);
+			break;
+		case ESignificanceBucket::Medium:
+			Actor -> SetActorTickInterval(CVarSignificanceMediumTickInterval.GetValueOnGameThread());
+			Actor -> SetActorTickEnabled(true);
+			break;
+		case ESignificanceBucket::Low:
+			Actor -> SetActorTickInterval(CVarSignificanceLowTickInterval.GetValueOnGameThread());
+			Actor -> SetActorTickEnabled(true);
+			break;
+		case ESignificanceBucket::Dormant:
+			Actor -> SetActorTickEnabled(false);
+			break;
+		default:
+			break;
+	}
+}
@@ -0,0 +1,55 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ActorSignificanceSubsystem.generated.h"
+
+enum class ESignificanceBucket : uint8
+{
+	High,
+	Medium,
+	Low,
+	Dormant,
+	Num
+};
+
+/**
+ * Scores registered world actors against every player viewpoint and scales their tick rate by significance bucket
+ */
+UCLASS()
+class SLP_API UActorSignificanceSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	// bCanDisableTick = false keeps the actor ticking at the lowest rate instead of going dormant
+	void RegisterActor(AActor* Actor, bool bCanDisableTick = true);
+	void UnregisterActor(AActor* Actor);
+
+	ESignificanceBucket GetBucket(const AActor* Actor) const;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	struct FSignificanceEntry
+	{
+		TWeakObjectPtr<AActor> Actor;
+		ESignificanceBucket Bucket = ESignificanceBucket::High;
+		bool bCanDisableTick = true;
+	};
+
+	void GatherViewpoints();
+	void UpdateSignificance();
+	ESignificanceBucket ScoreBucket(float DistanceSquared, ESignificanceBucket CurrentBucket) const;
+	void ApplyBucket(FSignificanceEntry& Entry, ESignificanceBucket NewBucket);
+
+	TArray<FSignificanceEntry> Entries;
+	TArray<FVector> Viewpoints;
+	float TimeSinceUpdate = 0.f;
+};
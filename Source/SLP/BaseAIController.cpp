@@ -3,3 +3,295 @@
 
 #include "BaseAIController.h"
 
+#include "SLP.h"
+#include "VisibilityCacheSubsystem.h"
+#include "PathRequestSubsystem.h"
+#include "CrowdBudgetSubsystem.h"
+#include "BaseCharacter.h"
+#include "Elevator.h"
+#include "Ladder.h"
+#include "NavLinkCustomComponent.h"
+#include "NavigationSystem.h"
+#include "Navigation/PathFollowingComponent.h"
+
+ABaseAIController::ABaseAIController(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer.SetDefaultSubobjectClass<UCrowdFollowingComponent>(TEXT("PathFollowingComponent")))
+{
+	LLM_SCOPE_BYTAG(SLP_AI);
+
+	PrimaryActorTick.bCanEverTick = true;
+}
+
+bool ABaseAIController::LineOfSightTo(const AActor* Other, FVector ViewPoint, bool bAlternateChecks) const
+{
+	UVisibilityCacheSubsystem* Visibility = GetWorld() -> GetSubsystem<UVisibilityCacheSubsystem>();
+	if(!Visibility or !GetPawn() or !ViewPoint.IsZero())	// custom view points can't be shared, trace them directly
+	{
+		return Super::LineOfSightTo(Other, ViewPoint, bAlternateChecks);
+	}
+	return Visibility -> QueryVisibility(GetPawn(), Other) == EVisibilityResult::Visible;
+}
+
+// Called every frame
+void ABaseAIController::Tick(float DeltaTime)
+{
+	LLM_SCOPE_BYTAG(SLP_AI);
+
+	Super::Tick(DeltaTime);
+
+	if(bTraversingNavLink)
+	{
+		if(TraversalActor.IsValid()) UpdateNavLinkTraversal(DeltaTime);
+		else	// the ladder or elevator went away mid traversal
+		{
+			FinishNavLinkTraversal();
+			StopMovement();
+		}
+
+		// the rest of the path was found for where the target was before the link
+		if(!bTraversingNavLink and ChaseTarget.IsValid()) RequestChasePath(ChaseTarget -> GetActorLocation());
+		return;	// a repath or crowd change now would replace the path waiting on the link
+	}
+
+	if(ChaseTarget.IsValid()) UpdateChase(DeltaTime);
+	if(GetMoveStatus() == EPathFollowingStatus::Idle) ApplyPendingCrowdState();
+}
+
+void ABaseAIController::OnPossess(APawn* InPawn)
+{
+	LLM_SCOPE_BYTAG(SLP_AI);
+
+	Super::OnPossess(InPawn);
+
+	if(UCrowdBudgetSubsystem* CrowdBudget = GetWorld() -> GetSubsystem<UCrowdBudgetSubsystem>())
+	{
+		CrowdBudget -> UnregisterAgent(this);
+		CrowdBudget -> RegisterAgent(this);
+	}
+}
+
+void ABaseAIController::OnUnPossess()
+{
+	if(bTraversingNavLink) FinishNavLinkTraversal();
+
+	if(UCrowdBudgetSubsystem* CrowdBudget = GetWorld() -> GetSubsystem<UCrowdBudgetSubsystem>())
+	{
+		CrowdBudget -> UnregisterAgent(this);
+	}
+
+	Super::OnUnPossess();
+}
+
+void ABaseAIController::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if(bTraversingNavLink) FinishNavLinkTraversal();
+
+	if(UCrowdBudgetSubsystem* CrowdBudget = GetWorld() -> GetSubsystem<UCrowdBudgetSubsystem>())
+	{
+		CrowdBudget -> UnregisterAgent(this);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void ABaseAIController::SetCrowdBudget(bool bSimulated, ECrowdAvoidanceQuality::Type Quality)
+{
+	UCrowdFollowingComponent* CrowdFollowing = Cast<UCrowdFollowingComponent>(GetPathFollowingComponent());
+	if(!CrowdFollowing) return;
+
+	// an obstacle only agent still takes a crowd manager slot and neighbour queries, the separation push handles the rest
+	PendingCrowdState = bSimulated ? ECrowdSimulationState::Enabled : ECrowdSimulationState::Disabled;
+	if(bSimulated) CrowdFollowing -> SetCrowdAvoidanceQuality(Quality);
+	if(GetMoveStatus() == EPathFollowingStatus::Idle) ApplyPendingCrowdState();
+}
+
+void ABaseAIController::ApplyPendingCrowdState()
+{
+	UCrowdFollowingComponent* CrowdFollowing = Cast<UCrowdFollowingComponent>(GetPathFollowingComponent());
+	if(CrowdFollowing and CrowdFollowing -> IsCrowdSimulationEnabled() != (PendingCrowdState == ECrowdSimulationState::Enabled))
+	{
+		CrowdFollowing -> SetCrowdSimulationState(PendingCrowdState);
+	}
+}
+
+void ABaseAIController::BeginNavLinkTraversal(AActor* LinkOwner, UNavLinkCustomComponent* Link, const FVector& Destination)
+{
+	ABaseCharacter* Character = Cast<ABaseCharacter>(GetPawn());
+	if(!Character)
+	{
+		GetPathFollowingComponent() -> FinishUsingCustomLink(Link);
+		return;
+	}
+
+	bTraversingNavLink = true;
+	TraversalActor = LinkOwner;
+	TraversalLink = Link;
+	TraversalDestination = Destination;
+	TraversalTime = 0.f;
+	bTraversalUp = Destination.Z > Character -> GetActorLocation().Z;
+	bTraversalBoarded = false;
+
+	Character -> SetNavWalkingLOD(false);	// ladders and platforms need the real movement
+	if(ALadder* Ladder = Cast<ALadder>(LinkOwner)) Ladder -> BeginClimb(Character, bTraversalUp);
+}
+
+void ABaseAIController::UpdateNavLinkTraversal(float DeltaTime)
+{
+	ABaseCharacter* Character = Cast<ABaseCharacter>(GetPawn());
+	TraversalTime += DeltaTime;
+	if(!Character or TraversalTime > NavLinkTimeout)
+	{
+		if(Character and Character -> GetCurrentState() == PlayerCurrentState::Ladder) Character -> SetCurrentState(PlayerCurrentState::Idle);
+		FinishNavLinkTraversal();
+		StopMovement();	// a chase repaths from wherever the pawn ended up
+		return;
+	}
+
+	if(ALadder* Ladder = Cast<ALadder>(TraversalActor.Get()))
+	{
+		Character -> SetLadderInput(bTraversalUp ? 1.f : -1.f);
+		if(Ladder -> HasReachedEnd(Character, bTraversalUp))
+		{
+			Ladder -> EndClimb(Character, bTraversalUp);
+			FinishNavLinkTraversal();
+		}
+		return;
+	}
+
+	AElevator* Elevator = Cast<AElevator>(TraversalActor.Get());
+	if(!Elevator) return;
+
+	// call the platform to this stop and walk onto it once it waits there, standing on it sends it on like a player
+	const FVector Location = Character -> GetActorLocation();
+	if(!bTraversalBoarded)
+	{
+		if(!Elevator -> IsRestingAt(!bTraversalUp))
+		{
+			Elevator -> CallTo(!bTraversalUp);	// ignored until it has finished a move the other way
+			return;
+		}
+
+		const FVector ToPlatform = (Elevator -> GetActorLocation() - Location) * FVector(1, 1, 0);
+		if(ToPlatform.SizeSquared() > FMath::Square(NavLinkAcceptanceRadius)) Character -> AddMovementInput(ToPlatform.GetSafeNormal());
+		else if(Elevator -> IsCarrying(Character))
+		{
+			bTraversalBoarded = true;
+			Elevator -> AddPassenger(Character);
+		}
+		return;
+	}
+
+	// then off at the other stop
+	if(!Elevator -> IsRestingAt(bTraversalUp)) return;
+
+	const FVector ToExit = (TraversalDestination - Location) * FVector(1, 1, 0);
+	if(ToExit.SizeSquared() > FMath::Square(NavLinkAcceptanceRadius)) Character -> AddMovementInput(ToExit.GetSafeNormal());
+	else FinishNavLinkTraversal();
+}
+
+void ABaseAIController::FinishNavLinkTraversal()
+{
+	if(AElevator* Elevator = Cast<AElevator>(TraversalActor.Get())) Elevator -> RemovePassenger(Cast<ABaseCharacter>(GetPawn()));
+	if(UNavLinkCustomComponent* Link = TraversalLink.Get()) GetPathFollowingComponent() -> FinishUsingCustomLink(Link);
+
+	bTraversingNavLink = false;
+	TraversalActor = nullptr;
+	TraversalLink = nullptr;
+}
+
+bool ABaseAIController::IsInCombat() const
+{
+	if(ChaseTarget.IsValid()) return true;
+
+	const ABaseCharacter* Character = Cast<ABaseCharacter>(GetPawn());
+	if(!Character) return false;
+	const PlayerCurrentState State = Character -> GetCurrentState();
+	return State == PlayerCurrentState::Attack or State == PlayerCurrentState::Stagger;
+}
+
+void ABaseAIController::ChaseActor(AActor* Target)
+{
+	ChaseTarget = Target;
+	TimeSinceRepath = 0.f;
+	if(ABaseCharacter* Character = Cast<ABaseCharacter>(GetPawn())) Character -> SetNavWalkingLOD(false);	// combat starts with full movement
+	if(Target) RequestChasePath(Target -> GetActorLocation());
+}
+
+void ABaseAIController::StopChasing()
+{
+	ChaseTarget = nullptr;
+	bPathRequestPending = false;
+	++PathRequestSerial;
+	StopMovement();
+}
+
+void ABaseAIController::UpdateChase(float DeltaTime)
+{
+	TimeSinceRepath += DeltaTime;
+	if(TimeSinceRepath < RepathInterval or bPathRequestPending) return;
+	TimeSinceRepath = 0.f;
+
+	const FVector Goal = ChaseTarget -> GetActorLocation();
+	const bool bIdle = GetMoveStatus() == EPathFollowingStatus::Idle;
+	if(!bIdle and FVector::DistSquared(Goal, LastGoalLocation) < FMath::Square(RepathDistance)) return;
+
+	if(!bIdle and TryRepairPath(Goal)) return;
+	RequestChasePath(Goal);
+}
+
+bool ABaseAIController::TryRepairPath(const FVector& NewGoal)
+{
+	UPathFollowingComponent* PathFollowing = GetPathFollowingComponent();
+	const FNavPathSharedPtr Path = PathFollowing ? PathFollowing -> GetPath() : nullptr;
+	if(!Path.IsValid() or Path -> GetPathPoints().Num() < 2) return false;
+
+	TArray<FNavPathPoint>& Points = Path -> GetPathPoints();
+	if(FVector::DistSquared(Points.Last().Location, NewGoal) > FMath::Square(RepairDistance)) return false;
+
+	// only the last leg changes, so it must still be walkable without a detour
+	const int32 LegStart = Points.Num() - 2;
+	if(PathFollowing -> GetNextPathIndex() > LegStart + 1) return false;
+
+	FVector HitLocation;
+	if(UNavigationSystemV1::NavigationRaycast(GetWorld(), Points[LegStart].Location, NewGoal, HitLocation, nullptr, this)) return false;
+
+	Points.Last().Location = NewGoal;
+	Path -> DoneUpdating(ENavPathUpdateType::GoalMoved);
+	LastGoalLocation = NewGoal;
+	return true;
+}
+
+void ABaseAIController::RequestChasePath(const FVector& Goal)
+{
+	UPathRequestSubsystem* PathRequests = GetWorld() -> GetSubsystem<UPathRequestSubsystem>();
+	if(!PathRequests or !GetPawn())
+	{
+		MoveToLocation(Goal, ChaseAcceptanceRadius);
+		LastGoalLocation = Goal;
+		return;
+	}
+
+	bPathRequestPending = true;
+	LastGoalLocation = Goal;
+	PathRequests -> RequestPath(GetPawn() -> GetNavAgentLocation(), Goal, FBatchedPathDelegate::CreateUObject(this, &ABaseAIController::OnChasePathFound, ++PathRequestSerial));
+}
+
+void ABaseAIController::OnChasePathFound(FNavPathSharedPtr Path, uint32 RequestSerial)
+{
+	if(!bPathRequestPending or RequestSerial != PathRequestSerial) return;	// chase was stopped or restarted while waiting
+	bPathRequestPending = false;
+	if(!Path.IsValid() or !ChaseTarget.IsValid() or bTraversingNavLink) return;	// mid link, the chase repaths once across
+
+	// a budget change waiting on the current move is applied between moves
+	UCrowdFollowingComponent* CrowdFollowing = Cast<UCrowdFollowingComponent>(GetPathFollowingComponent());
+	if(CrowdFollowing and CrowdFollowing -> IsCrowdSimulationEnabled() != (PendingCrowdState == ECrowdSimulationState::Enabled))
+	{
+		StopMovement();
+		ApplyPendingCrowdState();
+	}
+
+	// goal is a location, not the actor, so path following doesn't start its own repaths when the target moves
+	FAIMoveRequest MoveRequest(LastGoalLocation);
+	MoveRequest.SetAcceptanceRadius(ChaseAcceptanceRadius);
+	RequestMove(MoveRequest, Path);
+}
@@ -4,6 +4,8 @@
 
 #include "CoreMinimal.h"
 #include "AIController.h"
+#include "NavigationData.h"
+#include "Navigation/CrowdFollowingComponent.h"
 #include "BaseAIController.generated.h"
 
 /**
@@ -13,5 +15,87 @@ UCLASS()
 class SLP_API ABaseAIController : public AAIController
 {
 	GENERATED_BODY()
-	
+
+public:
+	ABaseAIController(const FObjectInitializer& ObjectInitializer = FObjectInitializer::Get());
+
+	// Called every frame
+	virtual void Tick(float DeltaTime) override;
+
+	// answered from the shared visibility cache, a pair that hasn't been traced yet counts as not seen
+	virtual bool LineOfSightTo(const AActor* Other, FVector ViewPoint = FVector(ForceInit), bool bAlternateChecks = false) const override;
+
+	// follows the target with paths from the shared path queue, small target moves patch the current path instead of asking for a new one
+	UFUNCTION(BlueprintCallable)
+	void ChaseActor(AActor* Target);
+
+	UFUNCTION(BlueprintCallable)
+	void StopChasing();
+
+	// set by the crowd budget, agents outside the crowd leave the crowd manager and are only kept apart by the separation push
+	void SetCrowdBudget(bool bSimulated, ECrowdAvoidanceQuality::Type Quality);
+
+	// chasing, attacking or staggered, keeps the full movement whatever the distance
+	bool IsInCombat() const;
+
+	// called by a ladder or elevator nav link when the path reaches it, path following waits until the pawn is across
+	void BeginNavLinkTraversal(AActor* LinkOwner, class UNavLinkCustomComponent* Link, const FVector& Destination);
+
+	// climbing or riding, needs the full movement since the platform and ladder aren't in the navmesh
+	bool IsTraversingNavLink() const { return bTraversingNavLink; }
+
+protected:
+	virtual void OnPossess(APawn* InPawn) override;
+	virtual void OnUnPossess() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+private:
+	// the crowd simulation state can only change while the agent isn't following a path
+	void ApplyPendingCrowdState();
+
+	void UpdateChase(float DeltaTime);
+	bool TryRepairPath(const FVector& NewGoal);
+	void RequestChasePath(const FVector& Goal);
+	void OnChasePathFound(FNavPathSharedPtr Path, uint32 RequestSerial);
+
+	void UpdateNavLinkTraversal(float DeltaTime);
+	void FinishNavLinkTraversal();
+
+	bool bTraversingNavLink = false;
+	TWeakObjectPtr<AActor> TraversalActor;
+	TWeakObjectPtr<class UNavLinkCustomComponent> TraversalLink;
+	FVector TraversalDestination = FVector::ZeroVector;
+	float TraversalTime = 0.f;
+	bool bTraversalUp = false;
+	bool bTraversalBoarded = false;
+
+	TWeakObjectPtr<AActor> ChaseTarget;
+	FVector LastGoalLocation = FVector::ZeroVector;
+	float TimeSinceRepath = 0.f;
+	bool bPathRequestPending = false;
+	uint32 PathRequestSerial = 0;	// answers to older requests are dropped
+	ECrowdSimulationState PendingCrowdState = ECrowdSimulationState::Disabled;
+
+	// how often the target is checked for having moved
+	UPROPERTY(EditAnywhere, Category = "Chase", meta = (AllowPrivateAccess = "true"))
+	float RepathInterval = 0.25f;
+
+	// target moves shorter than this are ignored
+	UPROPERTY(EditAnywhere, Category = "Chase", meta = (AllowPrivateAccess = "true"))
+	float RepathDistance = 50.f;
+
+	// target moves up to this far from the path end only move the end point, if it is reachable in a straight line
+	UPROPERTY(EditAnywhere, Category = "Chase", meta = (AllowPrivateAccess = "true"))
+	float RepairDistance = 300.f;
+
+	UPROPERTY(EditAnywhere, Category = "Chase", meta = (AllowPrivateAccess = "true"))
+	float ChaseAcceptanceRadius = 50.f;
+
+	// a ladder or elevator that hasn't got the pawn across by then is given up on and the move stopped
+	UPROPERTY(EditAnywhere, Category = "Navigation", meta = (AllowPrivateAccess = "true"))
+	float NavLinkTimeout = 30.f;
+
+	// how close to the platform centre and to the exit point counts as there
+	UPROPERTY(EditAnywhere, Category = "Navigation", meta = (AllowPrivateAccess = "true"))
+	float NavLinkAcceptanceRadius = 50.f;
 };
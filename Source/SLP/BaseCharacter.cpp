@@ -8,6 +8,7 @@
 #include "GameFramework/Controller.h"
 #include "Components/CapsuleComponent.h"
 #include "Components/StaticMeshComponent.h"
+#include "Components/SkeletalMeshComponent.h"
 #include "GameFramework/CharacterMovementComponent.h"
 #include "Camera/PlayerCameraManager.h"
 #include "EngineUtils.h"
@@ -18,11 +19,32 @@
 #include "EnhancedInputSubsystems.h"
 #include "EnhancedInputComponent.h"
 #include "Animation/AnimBlueprint.h"	
+#include "Animation/AnimInstance.h"
+#include "Engine/AssetManager.h"
+#include "Engine/StreamableManager.h"
 #include "Ladder.h"
+#include "LockOnTargetSubsystem.h"
+#include "VisibilityCacheSubsystem.h"
+#include "DamageQueueSubsystem.h"
+#include "HitHistorySubsystem.h"
+#include "FrameScratchArena.h"
+#include "Net/UnrealNetwork.h"
+#include "Net/Core/PushModel/PushModel.h"
+#include "SLP.h"
+
+#if ENABLE_VISUAL_LOG
+static const TCHAR* StateToString(PlayerCurrentState State)
+{
+	static const TCHAR* Names[(uint8)PlayerCurrentState::Num] = { TEXT("Idle"), TEXT("Locomotion"), TEXT("Sprint"), TEXT("Roll"), TEXT("Ladder"), TEXT("Attack"), TEXT("Stagger") };
+	return State < PlayerCurrentState::Num ? Names[(uint8)State] : TEXT("Invalid");
+}
+#endif
 
 // Sets default values
 ABaseCharacter::ABaseCharacter()
 {
+	LLM_SCOPE_BYTAG(SLP_Characters);
+
  	// Set this character to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
 	PrimaryActorTick.bCanEverTick = true;
 
@@ -35,6 +57,8 @@ ABaseCharacter::ABaseCharacter()
 	Camera = CreateDefaultSubobject<UCameraComponent>(TEXT("Camera"));
 	Camera -> SetupAttachment(SpringArm);
 
+	GetCharacterMovement() -> bSweepWhileNavWalking = false;	// the movement LOD is there to skip the sweeps
+
 	MoveAxisValue = 0.0f;
 	StrafeAxisValue = 0.0f;	
 	MoveLadderValue = 0.0f;
@@ -42,102 +66,629 @@ ABaseCharacter::ABaseCharacter()
 	bIsLockedOn = false;
 	bCameraOnTheRightLockedOn = false;
 	bIsGrounded = true;
-	bIsPlayerRunning = false;
+	bWantsToSprint = false;
 	bResetCamera = false;
-	bIsRolling = false;
-	bCanRoll = true;
-	bCanGoOnLadder = false;
+	bIsPooled = false;
 
-	SetCurrentState(PlayerCurrentState::Default);
+	StaggerDuration = 0.f;
+	CurrentState = PlayerCurrentState::Idle;	// no enter callback, nothing to set up yet
 
 	Health = MaxHealth;
 	Stamina = MaxStamina;
+	LastNotifiedHealth = Health;
+	LastNotifiedStamina = Stamina;
 }
 
 // Called when the game starts or when spawned
 void ABaseCharacter::BeginPlay()
 {
+	LLM_SCOPE_BYTAG(SLP_Characters);
+
 	Super::BeginPlay();
 
+	// simulated proxies never see a controller change, pick their profile here
+	ApplyComponentProfile();
+
+	if(ActorHasTag("Enemy"))
+	{
+		if(ULockOnTargetSubsystem* LockOnTargets = GetWorld() -> GetSubsystem<ULockOnTargetSubsystem>())
+		{
+			LockOnTargets -> RegisterTarget(this);
+		}
+	}
+
+	if(HasAuthority())
+	{
+		if(UHitHistorySubsystem* HitHistory = GetWorld() -> GetSubsystem<UHitHistorySubsystem>())
+		{
+			HitHistory -> RegisterCharacter(this);
+		}
+	}
+
+	// disabled until a lock on, the spring arm waits for it so the camera follows the late aim the same frame
+	LockOnCameraTick.Character = this;
+	LockOnCameraTick.bCanEverTick = true;
+	LockOnCameraTick.bStartWithTickEnabled = false;
+	LockOnCameraTick.TickGroup = TG_PostPhysics;
+	LockOnCameraTick.RegisterTickFunction(GetLevel());
+	SpringArm -> PrimaryComponentTick.AddPrerequisite(this, LockOnCameraTick);
+
 	PlayerController = Cast<APlayerController>(GetController());
 	if(!PlayerController) return;
 }
 
+// Called when the character is removed from the world
+void ABaseCharacter::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if(ULockOnTargetSubsystem* LockOnTargets = GetWorld() -> GetSubsystem<ULockOnTargetSubsystem>())
+	{
+		LockOnTargets -> UnregisterTarget(this);
+	}
+
+	if(UHitHistorySubsystem* HitHistory = GetWorld() -> GetSubsystem<UHitHistorySubsystem>())
+	{
+		HitHistory -> UnregisterCharacter(this);
+	}
+
+	if(LockOnCameraTick.IsTickFunctionRegistered())
+	{
+		SpringArm -> PrimaryComponentTick.RemovePrerequisite(this, LockOnCameraTick);
+		LockOnCameraTick.UnRegisterTickFunction();
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
 // Called every frame
 void ABaseCharacter::Tick(float DeltaTime)
 {
+	LLM_SCOPE_BYTAG(SLP_Characters);
+
 	Super::Tick(DeltaTime);
-	//UE_LOG(LogTemp, Warning, TEXT("canroll: %s"), bCanRoll ? TEXT("true") : TEXT("false"));
-	if(CurrentState == PlayerCurrentState::Ladder and abs(GetVelocity().Z) < 15.f) GetCharacterMovement() -> StopMovementImmediately();
-	// UE_LOG(LogTemp, Warning, TEXT("Current State: %s"), CurrentState == PlayerCurrentState::Default ? TEXT("Default") : TEXT("Ladder"));
-	// UE_LOG(LogTemp, Warning, TEXT("CanGoOnLadder: %s"), bCanGoOnLadder ? TEXT("true") : TEXT("false"));
+
+	// one entry per frame while capturing, it carries the snapshot
+	UE_VLOG(this, LogSLP, VeryVerbose, TEXT("%s"), StateToString(CurrentState));
+
+	// the state tick may transition, the work is taken from the state we end up in
+	if(const auto OnTick = GetStateDesc(CurrentState).OnTick) (this ->* OnTick)(DeltaTime);
+	const ECharacterTickWork TickWork = GetStateDesc(CurrentState).TickWork;
 	
-	ApplyMovement();
+	if(EnumHasAnyFlags(TickWork, ECharacterTickWork::Movement)) ApplyMovement();
 	MoveAxisValue = 0.0f;
     StrafeAxisValue = 0.0f;
 	MoveLadderValue = 0.0f;
 	
 	bIsGrounded = !GetCharacterMovement() -> IsFalling();
-	bCanGoOnLadder = CheckForLadder();
 
-	switch(CurrentState)
+	// while locked on the camera and rotation are left to the late tick, the target hasn't moved yet
+	const bool bLockOnCamera = bIsLockedOn and EnumHasAnyFlags(TickWork, ECharacterTickWork::LockOnCamera);
+	if(!bLockOnCamera and EnumHasAnyFlags(TickWork, ECharacterTickWork::Rotation))	HandleCharacterRotation(DeltaTime);
+
+	if(EnumHasAnyFlags(TickWork, ECharacterTickWork::Stamina))
+	{
+		const float NewStamina = StaminaSim.Step(Stamina, GetStaminaRules(), IsSprinting(), GetWorld() -> GetTimeSeconds(), DeltaTime);
+		if(NewStamina != Stamina) SetStamina(NewStamina);
+	}
+}
+
+void ABaseCharacter::ReceiveDamage(float DamageAmount)
+{
+	if(UDamageQueueSubsystem* DamageQueue = GetWorld() -> GetSubsystem<UDamageQueueSubsystem>())
 	{
-		case PlayerCurrentState::Default:
+		DamageQueue -> QueueDamage(this, DamageAmount);
+		return;
+	}
+
+	// no queue in this world (editor preview), resolve right away with the same rules
+	if(Health <= 0 or GetIsRolling()) return;
+	const float AppliedDamage = FMath::Min(Health, DamageAmount * (1.f - FMath::Clamp(DamageResistance, 0.f, 1.f)));
+	ApplyResolvedDamage(Health - AppliedDamage, AppliedDamage);
+}
+
+void ABaseCharacter::ApplyResolvedDamage(float NewHealth, float AppliedDamage)
+{
+	SetHealth(NewHealth);
+	OnHit.Broadcast(this, AppliedDamage);
+	SetNavWalkingLOD(false);	// getting hit is combat, don't wait for the next crowd budget update
+
+	if(Health <= 0)
+	{
+		OnDied.Broadcast(this);
+		return;
+	}
+	Stagger(HitStaggerDuration);
+}
+
+float ABaseCharacter::GetDamageResistance() const
+{
+	return DamageResistance;
+}
+
+void ABaseCharacter::SerializeSnapshot(FArchive& Ar)
+{
+	FTransform Transform = GetActorTransform();
+	float SavedHealth = Health;
+	float SavedStamina = Stamina;
+	uint8 SavedState = (uint8)CurrentState;
+	Ar << Transform << SavedHealth << SavedStamina << SavedState;
+	if(!Ar.IsLoading()) return;
+
+	SetActorTransform(Transform, false, nullptr, ETeleportType::TeleportPhysics);
+	GetCharacterMovement() -> StopMovementImmediately();
+	SetHealth(SavedHealth);
+	SetStamina(SavedStamina);
+
+	// timed states (roll, attack, stagger) aren't resumed, their timers are gone
+	SetCurrentState((PlayerCurrentState)SavedState == PlayerCurrentState::Ladder ? PlayerCurrentState::Ladder : PlayerCurrentState::Idle);
+}
+
+void ABaseCharacter::SetPooled(bool bPooled)
+{
+	if(bIsPooled == bPooled) return;
+	bIsPooled = bPooled;
+
+	SetActorHiddenInGame(bPooled);
+	SetActorEnableCollision(!bPooled);
+	SetActorTickEnabled(!bPooled);
+	GetCharacterMovement() -> SetComponentTickEnabled(!bPooled);
+	if(bPooled) GetCharacterMovement() -> StopMovementImmediately();
+	LockOnCameraTick.SetTickFunctionEnable(!bPooled and bIsLockedOn);
+	TransformHistory.Reset();	// never rewind across the pool
+
+	// a pooled enemy can't be locked on to
+	if(ActorHasTag("Enemy"))
+	{
+		if(ULockOnTargetSubsystem* LockOnTargets = GetWorld() -> GetSubsystem<ULockOnTargetSubsystem>())
 		{
-			if(bIsLockedOn)	HandleLockOnCamera(DeltaTime);
-			else	HandleCharacterRotation(DeltaTime);
-			break;
+			if(bPooled) LockOnTargets -> UnregisterTarget(this);
+			else LockOnTargets -> RegisterTarget(this);
 		}
 	}
+}
 
-	if(bIsPlayerRunning)
+#if ENABLE_VISUAL_LOG
+void ABaseCharacter::GrabDebugSnapshot(FVisualLogEntry* Snapshot) const
+{
+	FVisualLogStatusCategory Category(TEXT("SLP Character"));
+	Category.Add(TEXT("State"), StateToString(CurrentState));
+	Category.Add(TEXT("Health"), FString::Printf(TEXT("%.1f / %.1f"), Health, MaxHealth));
+	Category.Add(TEXT("Stamina"), FString::Printf(TEXT("%.1f / %.1f"), Stamina, MaxStamina));
+	Category.Add(TEXT("Locked On"), bIsLockedOn ? GetNameSafe(LockedTarget.Get()) : TEXT("no"));
+	Category.Add(TEXT("Candidates"), FString::FromInt(NearestActors.Num()));
+	Snapshot -> Status.Add(Category);
+
+	// the locked target in red, the other candidates in yellow labelled with their angle
+	const FVector Location = GetActorLocation();
+	for(const FLockOnCandidate& Candidate : NearestActors)
 	{
-		Stamina -= StaminaConsumptionRate * DeltaTime;
+		if(!Candidate.Actor.IsValid()) continue;
+		const FColor Color = Candidate.Actor == LockedTarget ? FColor::Red : FColor::Yellow;
+		Snapshot -> AddSegment(Location, Candidate.Actor -> GetActorLocation(), LogSLP.GetCategoryName(), ELogVerbosity::Log, Color, FString::Printf(TEXT("%.0f"), Candidate.Angle));
 	}
-	else
+}
+#endif
+
+bool ABaseCharacter::IsPooled() const
+{
+	return bIsPooled;
+}
+
+void ABaseCharacter::ResetForRespawn(const FTransform& SpawnTransform)
+{
+	// leave the current state first, its exit callback may start timers
+	SetCurrentState(PlayerCurrentState::Idle);
+	GetWorldTimerManager().ClearAllTimersForObject(this);
+	if(bIsLockedOn) ReleaseLockOn();
+	RollSim = SLPCore::FRollSim();
+	StaminaSim = SLPCore::FStaminaSim();
+	TransformHistory.Reset();
+
+	SetActorTransform(SpawnTransform, false, nullptr, ETeleportType::ResetPhysics);
+	GetCharacterMovement() -> StopMovementImmediately();
+	if(GetController()) GetController() -> SetControlRotation(SpawnTransform.Rotator());
+
+	SetHealth(MaxHealth);
+	SetStamina(MaxStamina);
+}
+
+bool ABaseCharacter::SetNavWalkingLOD(bool bNavWalking)
+{
+	UCharacterMovementComponent* Movement = GetCharacterMovement();
+	if(bNavWalking == (Movement -> MovementMode == MOVE_NavWalking)) return bNavWalking;
+	if(bNavWalking and Movement -> MovementMode != MOVE_Walking) return false;	// falling or climbing finish first, the next update tries again
+
+	Movement -> SetMovementMode(bNavWalking ? MOVE_NavWalking : MOVE_Walking);
+	return Movement -> MovementMode == MOVE_NavWalking;
+}
+
+void ABaseCharacter::SetLadderInput(float Value)
+{
+	MoveLadderValue = Value;
+}
+
+void ABaseCharacter::RecordTransformHistory(double ServerTime)
+{
+	LLM_SCOPE_BYTAG(SLP_Combat);
+
+	FTransform Hitboxes[MaxHistoryHitboxes];
+	const int32 NumHitboxes = FMath::Min(HitboxBones.Num(), MaxHistoryHitboxes);
+	for(int32 i = 0; i < NumHitboxes; ++i)
 	{
-		RegenStamina(DeltaTime);	
+		Hitboxes[i] = GetMesh() -> GetSocketTransform(HitboxBones[i]);
 	}
+	TransformHistory.Record(ServerTime, GetCapsuleComponent() -> GetComponentTransform(), MakeArrayView(Hitboxes, NumHitboxes), GetIsRolling());
 }
 
-void ABaseCharacter::ReceiveDamage(float DamageAmount)
+const FTransformHistory& ABaseCharacter::GetTransformHistory() const
+{
+	return TransformHistory;
+}
+
+void ABaseCharacter::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	// push based, only serialized after SetHealth/SetStamina marked them dirty
+	FDoRepLifetimeParams Params;
+	Params.bIsPushBased = true;
+	DOREPLIFETIME_WITH_PARAMS_FAST(ABaseCharacter, Health, Params);
+
+	Params.Condition = COND_OwnerOnly;	// only the owner's HUD shows stamina
+	DOREPLIFETIME_WITH_PARAMS_FAST(ABaseCharacter, Stamina, Params);
+}
+
+// a meaningful change is a big enough step or reaching empty/full, only gates the broadcast, every change replicates
+static bool ShouldNotifyAttribute(float NewValue, float LastNotified, float MaxValue, float Threshold)
+{
+	if(NewValue == LastNotified) return false;
+	if(FMath::Abs(NewValue - LastNotified) >= Threshold) return true;
+	return (NewValue <= 0.f) != (LastNotified <= 0.f) or (NewValue >= MaxValue) != (LastNotified >= MaxValue);
+}
+
+void ABaseCharacter::SetHealth(float NewHealth)
+{
+	if(Health == NewHealth) return;
+
+	Health = NewHealth;
+	MARK_PROPERTY_DIRTY_FROM_NAME(ABaseCharacter, Health, this);
+	if(!ShouldNotifyAttribute(Health, LastNotifiedHealth, MaxHealth, AttributeNotifyThreshold)) return;
+
+	LastNotifiedHealth = Health;
+	OnHealthChanged.Broadcast(this, Health, MaxHealth);
+}
+
+void ABaseCharacter::SetStamina(float NewStamina)
+{
+	if(Stamina == NewStamina) return;
+
+	Stamina = NewStamina;
+	MARK_PROPERTY_DIRTY_FROM_NAME(ABaseCharacter, Stamina, this);
+	if(!ShouldNotifyAttribute(Stamina, LastNotifiedStamina, MaxStamina, AttributeNotifyThreshold)) return;
+
+	LastNotifiedStamina = Stamina;
+	OnStaminaChanged.Broadcast(this, Stamina, MaxStamina);
+}
+
+void ABaseCharacter::OnRep_Health()
+{
+	LastNotifiedHealth = Health;
+	OnHealthChanged.Broadcast(this, Health, MaxHealth);
+}
+
+void ABaseCharacter::OnRep_Stamina()
+{
+	LastNotifiedStamina = Stamina;
+	OnStaminaChanged.Broadcast(this, Stamina, MaxStamina);
+}
+
+void ABaseCharacter::PostInitializeComponents()
+{
+	Super::PostInitializeComponents();
+
+	CaptureComponentDefaults();
+	RequestCharacterAssets();
+}
+
+void ABaseCharacter::GetResourceSizeEx(FResourceSizeEx& CumulativeResourceSize)
+{
+	Super::GetResourceSizeEx(CumulativeResourceSize);
+
+	CumulativeResourceSize.AddDedicatedSystemMemoryBytes(OutHits.GetAllocatedSize() + NearestActors.GetAllocatedSize() + TransformHistory.GetAllocatedSize());
+}
+
+void ABaseCharacter::NotifyControllerChanged()
 {
-	if(Health > 0) Health -= DamageAmount;
-	else Health = 0;
+	Super::NotifyControllerChanged();
+
+	ApplyComponentProfile();
+}
+
+const ABaseCharacter::FComponentProfileDesc& ABaseCharacter::GetComponentProfileDesc(ECharacterComponentProfile Profile)
+{
+	static const FComponentProfileDesc Profiles[(uint8)ECharacterComponentProfile::Num] =
+	{
+		/* LocalPlayer */		{ true, true, true, true },
+		/* Authority */			{ false, false, true, false },
+		/* SimulatedProxy */	{ false, false, false, false },
+	};
+	return Profiles[(uint8)Profile];
+}
+
+ECharacterComponentProfile ABaseCharacter::SelectComponentProfile() const
+{
+	if(IsLocallyControlled() and IsPlayerControlled()) return ECharacterComponentProfile::LocalPlayer;
+	if(GetLocalRole() == ROLE_SimulatedProxy) return ECharacterComponentProfile::SimulatedProxy;
+	return ECharacterComponentProfile::Authority;
+}
+
+void ABaseCharacter::CaptureComponentDefaults()
+{
+	ComponentDefaults.bMeshOverlaps = StaticMeshComponent -> GetGenerateOverlapEvents();
+	ComponentDefaults.bCapsuleOverlaps = GetCapsuleComponent() -> GetGenerateOverlapEvents();
+	ComponentDefaults.bSpringArmAbsoluteLocation = SpringArm -> IsUsingAbsoluteLocation();
+	ComponentDefaults.bSpringArmAbsoluteRotation = SpringArm -> IsUsingAbsoluteRotation();
+	ComponentDefaults.bSpringArmAbsoluteScale = SpringArm -> IsUsingAbsoluteScale();
+	if(GetMesh()) ComponentDefaults.AnimTickOption = GetMesh() -> VisibilityBasedAnimTickOption;
+}
+
+void ABaseCharacter::ApplyComponentProfile()
+{
+	const ECharacterComponentProfile NewProfile = SelectComponentProfile();
+	if(NewProfile == ComponentProfile) return;
+	ComponentProfile = NewProfile;
+
+	const FComponentProfileDesc& Desc = GetComponentProfileDesc(NewProfile);
+
+	// a fully absolute spring arm is skipped when the capsule moves, so the camera rig costs nothing until it is needed again
+	const bool bView = Desc.bViewComponents;
+	SpringArm -> SetComponentTickEnabled(bView);
+	SpringArm -> SetUsingAbsoluteLocation(bView ? ComponentDefaults.bSpringArmAbsoluteLocation : true);
+	SpringArm -> SetUsingAbsoluteRotation(bView ? ComponentDefaults.bSpringArmAbsoluteRotation : true);
+	SpringArm -> SetUsingAbsoluteScale(bView ? ComponentDefaults.bSpringArmAbsoluteScale : true);
+	Camera -> SetActive(bView);
+	if(bView) SpringArm -> UpdateComponentToWorld();
+
+	StaticMeshComponent -> SetGenerateOverlapEvents(Desc.bMeshOverlaps and ComponentDefaults.bMeshOverlaps);
+	GetCapsuleComponent() -> SetGenerateOverlapEvents(Desc.bCapsuleOverlaps and ComponentDefaults.bCapsuleOverlaps);
+
+	if(GetMesh())
+	{
+		GetMesh() -> VisibilityBasedAnimTickOption = Desc.bAlwaysTickPose ? ComponentDefaults.AnimTickOption : EVisibilityBasedAnimTickOption::OnlyTickMontagesWhenNotRendered;
+
+		// the hit history samples the hitbox bones on the server, where nothing is rendered to refresh them
+		if(HasAuthority() and !HitboxBones.IsEmpty()) GetMesh() -> VisibilityBasedAnimTickOption = EVisibilityBasedAnimTickOption::AlwaysTickPoseAndRefreshBones;
+	}
+}
+
+TArray<FSoftObjectPath> ABaseCharacter::GetCharacterAssetPaths() const
+{
+	TArray<FSoftObjectPath> Paths;
+	if(!InputMapping.IsNull()) Paths.Add(InputMapping.ToSoftObjectPath());
+
+	const TSoftObjectPtr<UInputAction>* InputActions[] = {
+		&InputMove, &InputStrafe, &InputLookUp, &InputLookRight, &InputLockOn,
+		&InputCameraRightLockedOn, &InputCameraLeftLockedOn, &InputRunDash, &InputRoll,
+		&InputAction, &InputMoveLadder, &InputStopMoveLadder, &InputLightAttack
+	};
+	for(const TSoftObjectPtr<UInputAction>* Action : InputActions)
+	{
+		if(!Action -> IsNull()) Paths.Add(Action -> ToSoftObjectPath());
+	}
+
+	if(!PlayerAnimClass.IsNull()) Paths.Add(PlayerAnimClass.ToSoftObjectPath());
+	return Paths;
+}
+
+void ABaseCharacter::RequestCharacterAssets()
+{
+	// usually already resident, the game mode starts this request while the map is loading
+	CharacterAssetsHandle = UAssetManager::GetStreamableManager().RequestAsyncLoad(
+		GetCharacterAssetPaths(),
+		FStreamableDelegate::CreateUObject(this, &ABaseCharacter::OnCharacterAssetsLoaded),
+		FStreamableManager::AsyncLoadHighPriority);
+}
+
+void ABaseCharacter::OnCharacterAssetsLoaded()
+{
+	if(UClass* AnimClass = PlayerAnimClass.Get()) GetMesh() -> SetAnimInstanceClass(AnimClass);
+	if(bInputBindingPending and InputComponent) BindInput(InputComponent);
 }
 
 // Called to bind functionality to input
 void ABaseCharacter::SetupPlayerInputComponent(UInputComponent* PlayerInputComponent)
 {
 	Super::SetupPlayerInputComponent(PlayerInputComponent);
+
+	// the actions are soft references, wait for them before binding
+	if(CharacterAssetsHandle.IsValid() and !CharacterAssetsHandle -> HasLoadCompleted())
+	{
+		bInputBindingPending = true;
+		return;
+	}
+	BindInput(PlayerInputComponent);
+}
+
+void ABaseCharacter::BindInput(UInputComponent* PlayerInputComponent)
+{
+	LLM_SCOPE_BYTAG(SLP_Characters);
+
+	bInputBindingPending = false;
 	auto NPlayerController = Cast<APlayerController>(GetController());
+	if(!NPlayerController) return;
 
     auto EISubsystem = ULocalPlayer::GetSubsystem<UEnhancedInputLocalPlayerSubsystem>(NPlayerController->GetLocalPlayer());
-    EISubsystem -> AddMappingContext(InputMapping, 0);
+    EISubsystem -> AddMappingContext(InputMapping.Get(), 0);
 	auto PlayerEIComponent = Cast<UEnhancedInputComponent>(PlayerInputComponent);
 
-	PlayerEIComponent -> BindAction(InputMove, ETriggerEvent::Triggered, this, &ABaseCharacter::Move);
-	PlayerEIComponent -> BindAction(InputStrafe, ETriggerEvent::Triggered, this, &ABaseCharacter::Strafe);
-	PlayerEIComponent -> BindAction(InputLookUp, ETriggerEvent::Triggered, this, &ABaseCharacter::LookUp);
-	PlayerEIComponent -> BindAction(InputLookRight, ETriggerEvent::Triggered, this, &ABaseCharacter::LookRight);
-	PlayerEIComponent -> BindAction(InputLockOn, ETriggerEvent::Started, this, &ABaseCharacter::LockOn);
+	PlayerEIComponent -> BindAction(InputMove.Get(), ETriggerEvent::Triggered, this, &ABaseCharacter::Move);
+	PlayerEIComponent -> BindAction(InputStrafe.Get(), ETriggerEvent::Triggered, this, &ABaseCharacter::Strafe);
+	PlayerEIComponent -> BindAction(InputLookUp.Get(), ETriggerEvent::Triggered, this, &ABaseCharacter::LookUp);
+	PlayerEIComponent -> BindAction(InputLookRight.Get(), ETriggerEvent::Triggered, this, &ABaseCharacter::LookRight);
+	PlayerEIComponent -> BindAction(InputLockOn.Get(), ETriggerEvent::Started, this, &ABaseCharacter::LockOn);
+
+	PlayerEIComponent -> BindAction(InputCameraRightLockedOn.Get(), ETriggerEvent::Triggered, this, &ABaseCharacter::DetermineCameraPlacement);
+	PlayerEIComponent -> BindAction(InputCameraLeftLockedOn.Get(), ETriggerEvent::Triggered, this, &ABaseCharacter::DetermineCameraPlacement);
 
-	PlayerEIComponent -> BindAction(InputCameraRightLockedOn, ETriggerEvent::Triggered, this, &ABaseCharacter::DetermineCameraPlacement);
-	PlayerEIComponent -> BindAction(InputCameraLeftLockedOn, ETriggerEvent::Triggered, this, &ABaseCharacter::DetermineCameraPlacement);
+	PlayerEIComponent -> BindAction(InputRoll.Get(), ETriggerEvent::Completed, this, &ABaseCharacter::StartRoll);
+	PlayerEIComponent -> BindAction(InputRunDash.Get(), ETriggerEvent::Triggered, this, &ABaseCharacter::Sprint);
+	PlayerEIComponent -> BindAction(InputAction.Get(), ETriggerEvent::Triggered, this, &ABaseCharacter::Action);
 
-	PlayerEIComponent -> BindAction(InputRoll, ETriggerEvent::Completed, this, &ABaseCharacter::StartRoll);
-	PlayerEIComponent -> BindAction(InputRunDash, ETriggerEvent::Triggered, this, &ABaseCharacter::Sprint);
-	PlayerEIComponent -> BindAction(InputAction, ETriggerEvent::Triggered, this, &ABaseCharacter::Action);
+	PlayerEIComponent -> BindAction(InputMoveLadder.Get(), ETriggerEvent::Triggered, this, &ABaseCharacter::MoveLadder);
+	PlayerEIComponent -> BindAction(InputStopMoveLadder.Get(), ETriggerEvent::Triggered, this, &ABaseCharacter::StopLadder);
 
-	PlayerEIComponent -> BindAction(InputMoveLadder, ETriggerEvent::Triggered, this, &ABaseCharacter::MoveLadder);
-	PlayerEIComponent -> BindAction(InputStopMoveLadder, ETriggerEvent::Triggered, this, &ABaseCharacter::StopLadder);
+	PlayerEIComponent -> BindAction(InputLightAttack.Get(), ETriggerEvent::Triggered, this, &ABaseCharacter::LightAttack);
+}
 
-	PlayerEIComponent -> BindAction(InputLightAttack, ETriggerEvent::Triggered, this, &ABaseCharacter::LightAttack);
+const ABaseCharacter::FStateDesc& ABaseCharacter::GetStateDesc(PlayerCurrentState State)
+{
+	using W = ECharacterTickWork;
+	static const FStateDesc StateTable[] =
+	{
+		/* Idle */			{ &ABaseCharacter::EnterIdle,	nullptr,						&ABaseCharacter::TickIdle,			W::Movement | W::LockOnCamera | W::Stamina },
+		/* Locomotion */	{ nullptr,						nullptr,						&ABaseCharacter::TickLocomotion,	W::Movement | W::Rotation | W::LockOnCamera | W::Stamina },
+		/* Sprint */		{ nullptr,						nullptr,						&ABaseCharacter::TickSprint,		W::Movement | W::Rotation | W::LockOnCamera | W::Stamina },
+		/* Roll */			{ &ABaseCharacter::EnterRoll,	&ABaseCharacter::ExitRoll,		&ABaseCharacter::TickRoll,			W::Movement | W::Rotation | W::LockOnCamera },
+		/* Ladder */		{ &ABaseCharacter::EnterLadder,	&ABaseCharacter::ExitLadder,	&ABaseCharacter::TickLadder,		W::Movement | W::Stamina },
+		/* Attack */		{ &ABaseCharacter::EnterAttack,	&ABaseCharacter::ExitAttack,	nullptr,							W::LockOnCamera | W::Stamina },
+		/* Stagger */		{ &ABaseCharacter::EnterStagger,	&ABaseCharacter::ExitStagger,	nullptr,							W::LockOnCamera | W::Stamina },
+	};
+	static_assert(UE_ARRAY_COUNT(StateTable) == (int32)PlayerCurrentState::Num, "every state needs an entry in the state table");
+
+	return StateTable[(int32)State];
 }
 
 void ABaseCharacter::SetCurrentState(PlayerCurrentState NewState)
 {
+	if(CurrentState == NewState) return;
+
+	if(const auto OnExit = GetStateDesc(CurrentState).OnExit) (this ->* OnExit)();
 	CurrentState = NewState;
+	if(const auto OnEnter = GetStateDesc(CurrentState).OnEnter) (this ->* OnEnter)();
+}
+
+void ABaseCharacter::EnterIdle()
+{
+	bWantsToSprint = false;	// stopping ends the sprint, same as releasing the input while standing
+}
+
+void ABaseCharacter::TickIdle(float DeltaTime)
+{
+	if(MoveAxisValue != 0.f or StrafeAxisValue != 0.f or !GetVelocity().IsNearlyZero()) SetCurrentState(PlayerCurrentState::Locomotion);
+}
+
+void ABaseCharacter::TickLocomotion(float DeltaTime)
+{
+	if(bWantsToSprint and Stamina > 0) SetCurrentState(PlayerCurrentState::Sprint);
+	else if(MoveAxisValue == 0.f and StrafeAxisValue == 0.f and GetVelocity().IsNearlyZero()) SetCurrentState(PlayerCurrentState::Idle);
+}
+
+void ABaseCharacter::TickSprint(float DeltaTime)
+{
+	if(!bWantsToSprint or Stamina <= 0)
+	{
+		bWantsToSprint = false;
+		SetCurrentState(PlayerCurrentState::Locomotion);
+	}
+}
+
+void ABaseCharacter::EnterRoll()
+{
+	UE_VLOG(this, LogSLP, Log, TEXT("Roll started"));
+	SetStamina(Stamina - RollSim.Start(GetRollRules(), GetWorld() -> GetTimeSeconds()));
+}
+
+void ABaseCharacter::ExitRoll()
+{
+	RollSim.End(GetRollRules(), GetWorld() -> GetTimeSeconds());	// cooldown starts here, also when the roll was interrupted
+}
+
+void ABaseCharacter::TickRoll(float DeltaTime)
+{
+	if(RollSim.IsFinished(GetWorld() -> GetTimeSeconds())) SetCurrentState(PlayerCurrentState::Locomotion);
+}
+
+SLPCore::FRollRules ABaseCharacter::GetRollRules() const
+{
+	SLPCore::FRollRules Rules;
+	Rules.StaminaCost = StaminaConsumptionRate;
+	Rules.Duration = InvincibilityTime;
+	Rules.Cooldown = RollCooldown;
+	return Rules;
+}
+
+SLPCore::FStaminaRules ABaseCharacter::GetStaminaRules() const
+{
+	SLPCore::FStaminaRules Rules;
+	Rules.MaxStamina = MaxStamina;
+	Rules.RegenRate = StaminaRegenRate;
+	Rules.DrainRate = StaminaConsumptionRate;
+	return Rules;
+}
+
+void ABaseCharacter::EnterLadder()
+{
+	GetCharacterMovement() -> SetMovementMode(EMovementMode::MOVE_Flying);
+}
+
+void ABaseCharacter::ExitLadder()
+{
+	GetCharacterMovement() -> SetMovementMode(EMovementMode::MOVE_Walking);
+}
+
+void ABaseCharacter::TickLadder(float DeltaTime)
+{
+	if(abs(GetVelocity().Z) < 15.f) GetCharacterMovement() -> StopMovementImmediately();
+}
+
+void ABaseCharacter::EnterAttack()
+{
+	GetWorld() -> GetTimerManager().SetTimer(AttackTimer, this, &ABaseCharacter::ReturnToIdle, AttackDuration, false);
+}
+
+void ABaseCharacter::ExitAttack()
+{
+	GetWorld() -> GetTimerManager().ClearTimer(AttackTimer);
+}
+
+void ABaseCharacter::EnterStagger()
+{
+	GetCharacterMovement() -> StopMovementImmediately();
+	GetWorld() -> GetTimerManager().SetTimer(StaggerTimer, this, &ABaseCharacter::ReturnToIdle, StaggerDuration, false);
+}
+
+void ABaseCharacter::ExitStagger()
+{
+	GetWorld() -> GetTimerManager().ClearTimer(StaggerTimer);
+}
+
+void ABaseCharacter::ReturnToIdle()
+{
+	SetCurrentState(PlayerCurrentState::Idle);
+}
+
+void ABaseCharacter::Stagger(float Duration)
+{
+	if(CurrentState == PlayerCurrentState::Ladder or Duration <= 0.f) return;
+
+	StaggerDuration = Duration;
+	if(CurrentState == PlayerCurrentState::Stagger)	// restart the stagger instead of stacking it
+	{
+		GetWorld() -> GetTimerManager().SetTimer(StaggerTimer, this, &ABaseCharacter::ReturnToIdle, StaggerDuration, false);
+		return;
+	}
+	SetCurrentState(PlayerCurrentState::Stagger);
+}
+
+bool ABaseCharacter::CanStartAction() const	// rolling and attacking are only allowed from the ground states
+{
+	return CurrentState == PlayerCurrentState::Idle
+		or CurrentState == PlayerCurrentState::Locomotion
+		or CurrentState == PlayerCurrentState::Sprint;
+}
+
+bool ABaseCharacter::IsSprinting() const
+{
+	return CurrentState == PlayerCurrentState::Sprint or (CurrentState == PlayerCurrentState::Ladder and bWantsToSprint);
 }
 
 PlayerCurrentState ABaseCharacter::GetCurrentState() const
@@ -145,20 +696,45 @@ PlayerCurrentState ABaseCharacter::GetCurrentState() const
 	return CurrentState;
 }
 
+void FLockOnCameraTickFunction::ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent)
+{
+	if(Character and TickType != LEVELTICK_ViewportsOnly) Character -> TickLockOnCamera(DeltaTime);
+}
+
+FString FLockOnCameraTickFunction::DiagnosticMessage()
+{
+	return TEXT("FLockOnCameraTickFunction");
+}
+
+void ABaseCharacter::TickLockOnCamera(float DeltaTime)
+{
+	// the state may have changed since Tick, it still decides whether the camera tracks the target
+	if(bIsLockedOn and EnumHasAnyFlags(GetStateDesc(CurrentState).TickWork, ECharacterTickWork::LockOnCamera)) HandleLockOnCamera(DeltaTime);
+}
+
 void ABaseCharacter::HandleLockOnCamera(float DeltaTime)
 {
-	FVector FocusPoint = NearestActors[ClosestEnemy] -> GetActorLocation();
+	RefreshLockOnCandidates();
+
 	FVector CameraLocation = Camera -> GetComponentLocation();
 
-	FVector DirectionVector = FocusPoint - CameraLocation;
-	if(DirectionVector.Length() > LockOnRange or OutHits[0].GetActor()->ActorHasTag("IsWall")) 	// if the player leaves the lock on range or a wall is the nearest actor
+	// the refresh skips the locked target, it is checked every frame instead (the sight line comes from the visibility cache)
+	if(!IsValidLockOnTarget(LockedTarget.Get(), CameraLocation))
 	{
-		bIsLockedOn = false;		// leave the locked on state
-		NearestActors.Empty();
-		SpringArm -> SetRelativeLocation(FVector(0, 0, 80));
-		return;
+		NearestActors.RemoveAll([this](const FLockOnCandidate& Candidate)
+		{
+			return Candidate.Actor == LockedTarget;
+		});
+		if(!SelectCenterLockOnTarget())	// nothing left to switch to
+		{
+			ReleaseLockOn();
+			return;
+		}
 	}
 
+	FVector FocusPoint = LockedTarget -> GetActorLocation();
+	FVector DirectionVector = FocusPoint - CameraLocation;
+
 	FRotator TargetCameraRotation = DirectionVector.Rotation();
 	FRotator CurrentControlRotation = PlayerController -> GetControlRotation();
 	FRotator NewControlRotation = FMath::RInterpTo(CurrentControlRotation, TargetCameraRotation, DeltaTime, 10.0f);
@@ -166,7 +742,7 @@ void ABaseCharacter::HandleLockOnCamera(float DeltaTime)
 	PlayerController -> SetControlRotation(NewControlRotation);	// camera rotation
     
 	// if the player is not running or rolling
-	if(!bIsPlayerRunning and !bIsRolling)
+	if(CurrentState != PlayerCurrentState::Sprint and CurrentState != PlayerCurrentState::Roll)
 	{
 //  	set actor rotation to face the lock on point
 		SetActorRotation(FRotator(0, NewControlRotation.Yaw, 0));
@@ -188,6 +764,9 @@ void ABaseCharacter::DoTrace()
 
 	FCollisionShape SweepSphere = FCollisionShape::MakeSphere(SweepRadius);
 
+	ULockOnTargetSubsystem* LockOnTargets = GetWorld() -> GetSubsystem<ULockOnTargetSubsystem>();
+	NearestActors.Reset();
+
 	if(GetWorld() -> UWorld::SweepMultiByChannel(
 		OutHits, 
 		StartLocation,
@@ -198,28 +777,124 @@ void ABaseCharacter::DoTrace()
 		Params
 	))
 	{
-		UE_LOG(LogTemp, Warning, TEXT("Trace Successful!"));
 		for (FHitResult& Hit : OutHits)
 		{
 			if (Hit.GetActor())
 			{
-				UE_LOG(LogTemp, Warning, TEXT("Hit Actor: %s"), *Hit.GetActor()->GetName());
+				UE_VLOG(this, LogSLP, Verbose, TEXT("Lock on sweep hit %s"), *Hit.GetActor() -> GetName());
 				if(Hit.GetActor() -> ActorHasTag("IsWall"))
 				{
-					UE_LOG(LogTemp, Warning, TEXT("Hit a wall!"));
+					UE_VLOG(this, LogSLP, Verbose, TEXT("Lock on sweep stopped by wall %s"), *Hit.GetActor() -> GetName());
 					break;
 				}
-				if(Hit.GetActor() -> ActorHasTag("Enemy")) NearestActors.AddUnique(Hit.GetActor());
+				if(Hit.GetActor() -> ActorHasTag("Enemy") and !NearestActors.ContainsByPredicate([&Hit](const FLockOnCandidate& Candidate) { return Candidate.Actor == Hit.GetActor(); }))
+				{
+					NearestActors.Add({ Hit.GetActor(), GetLockOnAngle(Hit.GetActor()) });
+					if(LockOnTargets) LockOnTargets -> RegisterTarget(Hit.GetActor());	// enemies that don't register themselves are still tracked once seen
+				}
 			}
 		}
-		UE_LOG(LogTemp, Warning, TEXT("Nearest Actors Count: %d"), NearestActors.Num());
+		NearestActors.Sort([](const FLockOnCandidate& A, const FLockOnCandidate& B) { return A.Angle < B.Angle; });
+		UE_VLOG(this, LogSLP, Log, TEXT("Lock on candidates: %d"), NearestActors.Num());
+	}
+}
+
+void ABaseCharacter::RefreshLockOnCandidates()
+{
+	const FVector CameraLocation = Camera -> GetComponentLocation();
+	bool bChanged = false;
+
+	// revalidate a slice of the candidates, dead, out of range or occluded ones are dropped
+	for(int32 Checked = 0; Checked < LockOnRefreshBudget and !NearestActors.IsEmpty(); ++Checked)
+	{
+		if(CandidateRefreshCursor >= NearestActors.Num()) CandidateRefreshCursor = 0;
+
+		FLockOnCandidate& Candidate = NearestActors[CandidateRefreshCursor];
+		if(Candidate.Actor != LockedTarget and !IsValidLockOnTarget(Candidate.Actor.Get(), CameraLocation))
+		{
+			NearestActors.RemoveAt(CandidateRefreshCursor);	// keeps the order, no need to resort
+			continue;
+		}
+		Candidate.Angle = GetLockOnAngle(Candidate.Actor.Get());
+
+		// only a new angle that lands out of order against its neighbours needs the resort
+		const int32 Index = CandidateRefreshCursor;
+		if((Index > 0 and NearestActors[Index - 1].Angle > Candidate.Angle) or (Index + 1 < NearestActors.Num() and Candidate.Angle > NearestActors[Index + 1].Angle)) bChanged = true;
+		++CandidateRefreshCursor;
+	}
+
+	// pick up enemies that came into range, a slice of the registry per frame
+	ULockOnTargetSubsystem* LockOnTargets = GetWorld() -> GetSubsystem<ULockOnTargetSubsystem>();
+	if(LockOnTargets)
+	{
+		const TArray<TWeakObjectPtr<AActor>>& Targets = LockOnTargets -> GetTargets();
+		for(int32 Checked = 0; Checked < LockOnRefreshBudget and Checked < Targets.Num(); ++Checked)
+		{
+			TargetRegistryCursor = (TargetRegistryCursor + 1) % Targets.Num();
+			AActor* Target = Targets[TargetRegistryCursor].Get();
+			if(!Target or Target == this) continue;
+
+			const bool bKnown = NearestActors.ContainsByPredicate([Target](const FLockOnCandidate& Candidate)
+			{
+				return Candidate.Actor == Target;
+			});
+			if(bKnown or !IsValidLockOnTarget(Target, CameraLocation)) continue;
+
+			NearestActors.Add({ Target, GetLockOnAngle(Target) });
+			bChanged = true;
+		}
 	}
+
+	// the list is nearly sorted already, so this stays cheap
+	if(bChanged) NearestActors.StableSort([](const FLockOnCandidate& A, const FLockOnCandidate& B) { return A.Angle < B.Angle; });
+}
+
+bool ABaseCharacter::IsValidLockOnTarget(const AActor* Target, const FVector& CameraLocation) const
+{
+	if(!IsValid(Target) or Target -> IsActorBeingDestroyed()) return false;
+
+	const ABaseCharacter* TargetCharacter = Cast<ABaseCharacter>(Target);
+	if(TargetCharacter and TargetCharacter -> GetHealth() <= 0) return false;
+
+	const FVector TargetLocation = Target -> GetActorLocation();
+	if(FVector::DistSquared(CameraLocation, TargetLocation) > FMath::Square(LockOnRange)) return false;
+
+	// a wall between us and the target breaks the lock, a pair that hasn't been traced yet is given the benefit of the doubt
+	UVisibilityCacheSubsystem* Visibility = GetWorld() -> GetSubsystem<UVisibilityCacheSubsystem>();
+	return !Visibility or Visibility -> QueryVisibility(this, Target) != EVisibilityResult::Occluded;
+}
+
+float ABaseCharacter::GetLockOnAngle(const AActor* Target) const
+{
+	const FVector Direction = Target -> GetActorLocation() - Camera -> GetComponentLocation();
+	return FMath::FindDeltaAngleDegrees(Camera -> GetComponentRotation().Yaw, Direction.Rotation().Yaw);
+}
+
+bool ABaseCharacter::SelectCenterLockOnTarget()	// the candidate closest to the middle of the screen
+{
+	const FLockOnCandidate* Best = nullptr;
+	for(const FLockOnCandidate& Candidate : NearestActors)
+	{
+		if(!Candidate.Actor.IsValid()) continue;
+		if(!Best or abs(Candidate.Angle) < abs(Best -> Angle)) Best = &Candidate;
+	}
+	LockedTarget = Best ? Best -> Actor : nullptr;
+	return Best != nullptr;
+}
+
+void ABaseCharacter::ReleaseLockOn()
+{
+	bIsLockedOn = false;		// leave the locked on state
+	LockOnCameraTick.SetTickFunctionEnable(false);
+	NearestActors.Empty();
+	LockedTarget = nullptr;
+	SpringArm -> SetRelativeLocation(FVector(0, 0, 80));
 }
 
 float ABaseCharacter::GetSpeed() const	// for animation blueprint
 {
 	float Speed = abs(GetVelocity().GetSafeNormal().Size());
-	return bIsPlayerRunning ? Speed : Speed * 0.7;
+	return IsSprinting() ? Speed : Speed * 0.7;
 }
 
 float ABaseCharacter::GetDirection() const	// for animation blueprint
@@ -232,24 +907,6 @@ bool ABaseCharacter::IsLockedOn() const	// for animation blueprint
 	return bIsLockedOn;
 }
 
-void ABaseCharacter::RegenStamina(float DeltaTime)
-{
-	if(Stamina < 0)
-	{
-		Stamina = 0;
-		GetWorld() -> GetTimerManager().SetTimer(StaminaRegenCooldown, this, &ABaseCharacter::DummyFun, 1.f, false);
-	}
-	else
-	{
-		if(GetWorldTimerManager().IsTimerActive(StaminaRegenCooldown)) return;
-		if(Stamina < MaxStamina)
-		{
-			if(!bIsRolling) Stamina += StaminaRegenRate * DeltaTime;
-		} 
-		else Stamina = MaxStamina;
-	}
-}
-
 float ABaseCharacter::GetStamina() const
 {
 	return Stamina;
@@ -262,15 +919,21 @@ float ABaseCharacter::GetHealth() const
 
 bool ABaseCharacter::GetIsRolling() const
 {
-	return bIsRolling;
+	return CurrentState == PlayerCurrentState::Roll;
 }
 
 void ABaseCharacter::ToggleEnemyWhenLockedOn(float AxisValue)
 {
-	if(!NearestActors.IsEmpty())
+	if(NearestActors.IsEmpty()) return;
+
+	// the candidates are sorted left to right, so switching is a step along the list
+	int32 Index = NearestActors.IndexOfByPredicate([this](const FLockOnCandidate& Candidate)
 	{
-		ClosestEnemy = abs(++ClosestEnemy) % NearestActors.Num();	// ensure that the index doesn't go out of bounds
-	}
+		return Candidate.Actor == LockedTarget;
+	});
+	const int32 Step = AxisValue < 0 ? -1 : 1;
+	Index = Index == INDEX_NONE ? 0 : (Index + Step + NearestActors.Num()) % NearestActors.Num();	// ensure that the index doesn't go out of bounds
+	LockedTarget = NearestActors[Index].Actor;
 }
 
 void ABaseCharacter::HandleCharacterRotation(float DeltaTime)
@@ -303,9 +966,9 @@ void ABaseCharacter::ApplyMovement()
 {
     if (!PlayerController) return;
 	
-	float SpeedScale = bIsPlayerRunning ? 1.0f : 0.7f;
+	float SpeedScale = IsSprinting() ? 1.0f : 0.7f;
 	switch(CurrentState){
-		case PlayerCurrentState::Default:
+		default:
 		{
 			const FRotator Rotation = PlayerController -> GetControlRotation();
 			const FRotator YawRotation(0, Rotation.Yaw, 0);
@@ -326,7 +989,6 @@ void ABaseCharacter::ApplyMovement()
 		case PlayerCurrentState::Ladder:
 		{
 			// TODO: add sliding down
-			UE_LOG(LogTemp, Warning, TEXT("isplayerrunning: %s"), bIsPlayerRunning ? TEXT("true") : TEXT("false"));
 			AddMovementInput(FVector::UpVector, MoveLadderValue * SpeedScale * RunSpeed * GetWorld() -> GetDeltaSeconds());
 			break;
 		}
@@ -335,25 +997,25 @@ void ABaseCharacter::ApplyMovement()
 
 void ABaseCharacter::LockOn()	// refactored to use FInputActionValue
 {
-	UE_LOG(LogTemp, Display, TEXT("MOUSE3 PRESSED"));
+	LLM_SCOPE_BYTAG(SLP_Combat);
+
+	if(bIsLockedOn)	// if already locked on
+	{				// lock off and clear the array, no need to sweep
+		UE_VLOG(this, LogSLP, Log, TEXT("Locked off"));
+		ReleaseLockOn();
+		return;
+	}
+
 	DoTrace();
 
 	// was the trace successful?
-	if(!NearestActors.IsEmpty())
-	{
+	if(SelectCenterLockOnTarget())
+	{				// lock on, the candidates are maintained incrementally from here
+		UE_VLOG(this, LogSLP, Log, TEXT("Locked on %s"), *GetNameSafe(LockedTarget.Get()));
 		SpringArm -> SetRelativeLocation(FVector(0, 0, 80));
-		if(bIsLockedOn)	// if already locked on
-		{				// lock off and clear the array
-			UE_LOG(LogTemp, Warning, TEXT("Locked off..."));
-			bIsLockedOn = false;
-			NearestActors.Empty();
-		}
-		else
-		{				// lock on
-			UE_LOG(LogTemp, Warning, TEXT("Locked on!"));
-			bIsLockedOn = true;
-		}
-		ClosestEnemy = 0;
+		bIsLockedOn = true;
+		LockOnCameraTick.SetTickFunctionEnable(true);
+		CandidateRefreshCursor = 0;
 	}
 	else{
 		// TODO: Reset camera to default position (when pressing MOUSE3 if not locked on)
@@ -373,7 +1035,6 @@ void ABaseCharacter::LookRight(const FInputActionValue & Value)	// refactored to
 	float AxisValue = Value.Get<float>();
 	//UE_LOG(LogTemp, Display, TEXT("Look Right value: %f"), AxisValue);
 	// UE_LOG(LogTemp, Warning, TEXT("OutHits.Num(): %i"), NearestActors.Num()-1);
-	// UE_LOG(LogTemp, Warning, TEXT("ClosestEnemy: %i"), ClosestEnemy);
 
 	if(!bIsLockedOn) AddControllerYawInput(AxisValue);
 	else ToggleEnemyWhenLockedOn(AxisValue);
@@ -384,16 +1045,15 @@ void ABaseCharacter::DetermineCameraPlacement(const FInputActionValue & Value)
 	if(bIsLockedOn)
 	{
 		float AxisValue = Value.Get<float>();
-		UE_LOG(LogTemp, Display, TEXT("Camera Placement value: %f"), AxisValue);
 		if(AxisValue == 1)
 		{
 			bCameraOnTheRightLockedOn = false;
-			UE_LOG(LogTemp, Warning, TEXT("Camera on the right locked on"));
+			UE_VLOG(this, LogSLP, Verbose, TEXT("Camera on the right locked on"));
 		}
 		else if(AxisValue == -1)
 		{
 			bCameraOnTheRightLockedOn = true;
-			UE_LOG(LogTemp, Warning, TEXT("Camera on the left locked on"));
+			UE_VLOG(this, LogSLP, Verbose, TEXT("Camera on the left locked on"));
 		}
 	}
 }
@@ -402,50 +1062,39 @@ void ABaseCharacter::Sprint(const FInputActionValue & Value)
 {
 	if(Stamina <= 0 or !GetVelocity().SizeSquared())	// when out of stamina or not moving
 	{
-		bIsPlayerRunning = false;
+		bWantsToSprint = false;
 		return;
 	}
 	//UE_LOG(LogTemp, Display, TEXT("Velocity value: %f"), GetVelocity().SizeSquared());
 	if(GetVelocity().SizeSquared() > 0.0f)
 	{
-		UE_LOG(LogTemp, Warning, TEXT("sprinting: %s"), Value.Get<bool>() ? TEXT("true") : TEXT("false"));
-		bIsPlayerRunning = Value.Get<bool>();		// the player has to be moving to sprint
+		UE_VLOG(this, LogSLP, Verbose, TEXT("Sprinting: %s"), Value.Get<bool>() ? TEXT("true") : TEXT("false"));
+		bWantsToSprint = Value.Get<bool>();		// the player has to be moving to sprint
 	} 
 }
 
 void ABaseCharacter::StartRoll(const FInputActionValue & Value)
 {
-	if(Stamina <= 0) return;
-	if(GetVelocity().SizeSquared())
-	{
-		FVector Velocity = GetVelocity();
-		FRotator TargetRotation = FRotationMatrix::MakeFromX(Velocity).Rotator();		// target rotation from velocity vector
-		SetActorRotation(TargetRotation);
-	}
-	else return;
+	if(!CanStartAction() or !RollSim.CanStart(Stamina, GetVelocity().SizeSquared() > 0.f, GetWorld() -> GetTimeSeconds())) return;
 
-	if(!bIsRolling and bCanRoll)
-	{
-		bIsRolling = true;
-		bCanRoll = false;
-		GetWorld() -> GetTimerManager().SetTimer(RollTimer, this, &ABaseCharacter::SetIsRolling, InvincibilityTime, false);
-		UE_LOG(LogTemp, Display, TEXT("Roll started!"));
-		Stamina -= StaminaConsumptionRate;	
-	}
+	FVector Velocity = GetVelocity();
+	FRotator TargetRotation = FRotationMatrix::MakeFromX(Velocity).Rotator();		// target rotation from velocity vector
+	SetActorRotation(TargetRotation);
+
+	SetCurrentState(PlayerCurrentState::Roll);
 }
 
 void ABaseCharacter::Action(const struct FInputActionValue & Value)
 {
-	if(bCanGoOnLadder)
+	if(CanStartAction() and CheckForLadder())	// only checked when asked, no state pays for it every frame
 	{
 		SetCurrentState(PlayerCurrentState::Ladder);
-		GetCharacterMovement() -> SetMovementMode(EMovementMode::MOVE_Flying);
-		bCanRoll = false;
 	}
 }
 
 void ABaseCharacter::LightAttack(const struct FInputActionValue & Value)
 {
+	if(CanStartAction()) SetCurrentState(PlayerCurrentState::Attack);
 	// TODO: attack logic
 }
 
@@ -454,21 +1103,11 @@ void ABaseCharacter::MoveLadder(const struct FInputActionValue & Value)
 	MoveLadderValue = Value.Get<float>();
 }
 
-void ABaseCharacter::SetIsRolling()
-{
-    bIsRolling = false;
-	GetWorld() -> GetTimerManager().SetTimer(RollCooldownTimer, this, &ABaseCharacter::SetCanRoll, InvincibilityTime, false);
-}
-
-void ABaseCharacter::SetCanRoll()
-{
-	bCanRoll = true;
-}
-
 bool ABaseCharacter::CheckForLadder()
 {
-	TArray<AActor*> Triggers;
-	GetOverlappingActors(Triggers, ALadder::StaticClass());
+	// ladder triggers overlap the capsule, no other component needs checking
+	TArray<AActor*, FFrameScratchAllocator> Triggers;
+	GetOverlappingActorsOfClass(GetCapsuleComponent(), Triggers, ALadder::StaticClass());
 	if(Triggers.Num() > 0)
 	{
 		return true;
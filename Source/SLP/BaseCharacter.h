@@ -4,16 +4,75 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Character.h"
+#include "Components/SkinnedMeshComponent.h"
+#include "VisualLogger/VisualLoggerDebugSnapshotInterface.h"
+#include "SimulationCore.h"
+#include "TransformHistory.h"
 #include "BaseCharacter.generated.h"
 
+class UInputMappingContext;
+class UInputAction;
+struct FStreamableHandle;
+
 enum class PlayerCurrentState : uint8
 {
-	Default,
-	Ladder
+	Idle,
+	Locomotion,
+	Sprint,
+	Roll,
+	Ladder,
+	Attack,
+	Stagger,
+	Num
+};
+
+// per-frame work a state needs, anything not declared is skipped in Tick
+enum class ECharacterTickWork : uint8
+{
+	None			= 0,
+	Movement		= 1 << 0,	// turn the move input into movement input (planar or ladder)
+	Rotation		= 1 << 1,	// rotate the character towards its velocity
+	LockOnCamera	= 1 << 2,	// track the lock on target while locked on
+	Stamina			= 1 << 3	// drain while sprinting, regen otherwise
+};
+ENUM_CLASS_FLAGS(ECharacterTickWork);
+
+// which components a character keeps running, picked from who controls it on this machine
+enum class ECharacterComponentProfile : uint8
+{
+	LocalPlayer,		// everything, the camera rig included
+	Authority,			// server copy of an AI or a remote player, nobody looks through it here
+	SimulatedProxy,		// another machine's character on a client, only what is seen
+	Num
+};
+
+// post physics tick of a locked on character, aims the camera once every character has moved this frame
+USTRUCT()
+struct FLockOnCameraTickFunction : public FTickFunction
+{
+	GENERATED_BODY()
+
+	class ABaseCharacter* Character = nullptr;
+
+	virtual void ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent) override;
+	virtual FString DiagnosticMessage() override;
 };
 
+template<>
+struct TStructOpsTypeTraits<FLockOnCameraTickFunction> : public TStructOpsTypeTraitsBase2<FLockOnCameraTickFunction>
+{
+	enum
+	{
+		WithCopy = false
+	};
+};
+
+DECLARE_MULTICAST_DELEGATE_TwoParams(FOnCharacterHit, class ABaseCharacter* /* Victim */, float /* AppliedDamage */);
+DECLARE_MULTICAST_DELEGATE_OneParam(FOnCharacterDied, class ABaseCharacter* /* Victim */);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_ThreeParams(FOnCharacterAttributeChanged, class ABaseCharacter*, Character, float, NewValue, float, MaxValue);
+
 UCLASS()
-class SLP_API ABaseCharacter : public ACharacter
+class SLP_API ABaseCharacter : public ACharacter, public IVisualLoggerDebugSnapshotInterface
 {
 	GENERATED_BODY()
 
@@ -25,62 +84,183 @@ protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
 
+	// Called when the character is removed from the world
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 public:	
 	// Called every frame
 	virtual void Tick(float DeltaTime) override;
 
+	// queues the damage, it is resolved with the rest of the frame's damage by UDamageQueueSubsystem
 	void ReceiveDamage(float DamageAmount);
 
-	// Called to bind functionality to input
+	// called by the damage queue on the game thread once the frame's damage is resolved
+	void ApplyResolvedDamage(float NewHealth, float AppliedDamage);
+
+	float GetDamageResistance() const;
+
+	// writes or reads (Ar.IsLoading()) the state kept in world snapshots
+	void SerializeSnapshot(FArchive& Ar);
+
+#if ENABLE_VISUAL_LOG
+	// state, attributes and lock on candidates, shown by the visual logger and the SLP gameplay debugger category
+	virtual void GrabDebugSnapshot(FVisualLogEntry* Snapshot) const override;
+#endif
+
+	// pooled characters are hidden, don't collide or tick, and wait for the game mode to respawn them
+	void SetPooled(bool bPooled);
+	bool IsPooled() const;
+
+	// puts the character back in its spawn state at SpawnTransform without going through BeginPlay again
+	void ResetForRespawn(const FTransform& SpawnTransform);
+
+	// movement LOD for AI far from players, nav walking follows the navmesh without floor sweeps or collision
+	// returns whether the character is nav walking afterwards, the switch waits while falling or climbing
+	bool SetNavWalkingLOD(bool bNavWalking);
+
+	// climb input for AI on a ladder, the same value the ladder input action sets
+	void SetLadderInput(float Value);
+
+	// server only, called by UHitHistorySubsystem once the frame's movement is done
+	void RecordTransformHistory(double ServerTime);
+	const FTransformHistory& GetTransformHistory() const;
+
+	FOnCharacterHit OnHit;
+	FOnCharacterDied OnDied;
+
+	// fired when the value moved by AttributeNotifyThreshold or reached empty/full, bind widgets here instead of polling
+	UPROPERTY(BlueprintAssignable)
+	FOnCharacterAttributeChanged OnHealthChanged;
+
+	UPROPERTY(BlueprintAssignable)
+	FOnCharacterAttributeChanged OnStaminaChanged;
+
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
+	virtual void PostInitializeComponents() override;
+
+	// adds the plain containers slp.Memory.Dump can't see through the properties
+	virtual void GetResourceSizeEx(FResourceSizeEx& CumulativeResourceSize) override;
+
+	// possession, unpossession and the controller replicating in all land here, the component profile follows
+	virtual void NotifyControllerChanged() override;
+
+	// Called to bind functionality to input, deferred until the input assets have streamed in
 	virtual void SetupPlayerInputComponent(class UInputComponent* PlayerInputComponent) override;
+
+	// the soft input and animation assets, loaded together as one async request
+	TArray<FSoftObjectPath> GetCharacterAssetPaths() const;
 	
 	PlayerCurrentState GetCurrentState() const;
 
 	void SetCurrentState(PlayerCurrentState NewState);
-	void SetIsRolling();
-	void SetCanRoll();
+	void Stagger(float Duration);
+
+	UFUNCTION(BlueprintCallable)
+	float GetStamina() const;
+
+	UFUNCTION(BlueprintCallable)
+	float GetHealth() const;
+
+	UFUNCTION(BlueprintCallable)
+	bool GetIsRolling() const;
 private:
+	struct FStateDesc
+	{
+		void (ABaseCharacter::*OnEnter)();
+		void (ABaseCharacter::*OnExit)();
+		void (ABaseCharacter::*OnTick)(float DeltaTime);
+		ECharacterTickWork TickWork;
+	};
+
+	static const FStateDesc& GetStateDesc(PlayerCurrentState State);
+
+	struct FComponentProfileDesc
+	{
+		bool bViewComponents;	// spring arm and camera tick and follow the capsule
+		bool bMeshOverlaps;		// the static mesh generates overlap events
+		bool bCapsuleOverlaps;	// the capsule generates overlap events, ladders and damage volumes need it
+		bool bAlwaysTickPose;	// the skeletal mesh animates when not rendered, montages always tick
+	};
+
+	// what each profile keeps, anything off is turned off, anything on goes back to how the component was authored
+	static const FComponentProfileDesc& GetComponentProfileDesc(ECharacterComponentProfile Profile);
+	ECharacterComponentProfile SelectComponentProfile() const;
+	void CaptureComponentDefaults();
+	void ApplyComponentProfile();
+
+	ECharacterComponentProfile ComponentProfile = ECharacterComponentProfile::Num;
+
+	struct FComponentDefaults
+	{
+		bool bMeshOverlaps = true;
+		bool bCapsuleOverlaps = true;
+		bool bSpringArmAbsoluteLocation = false;
+		bool bSpringArmAbsoluteRotation = false;
+		bool bSpringArmAbsoluteScale = false;
+		EVisibilityBasedAnimTickOption AnimTickOption = EVisibilityBasedAnimTickOption::AlwaysTickPoseAndRefreshBones;
+	};
+	FComponentDefaults ComponentDefaults;
+
+	void EnterRoll();
+	void ExitRoll();
+	void TickRoll(float DeltaTime);
+	void EnterLadder();
+	void ExitLadder();
+	void EnterAttack();
+	void ExitAttack();
+	void EnterStagger();
+	void ExitStagger();
+	void EnterIdle();
+	void TickIdle(float DeltaTime);
+	void TickLocomotion(float DeltaTime);
+	void TickSprint(float DeltaTime);
+	void TickLadder(float DeltaTime);
+	void ReturnToIdle();
+	bool CanStartAction() const;
+	bool IsSprinting() const;
+
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Enhanced Input", meta = (AllowPrivateAccess = "true"))
-    class UInputMappingContext * InputMapping;
+    TSoftObjectPtr<UInputMappingContext> InputMapping;
 
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Enhanced Input", meta = (AllowPrivateAccess = "true"))
-	class UInputAction * InputMove;
+	TSoftObjectPtr<UInputAction> InputMove;
 
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Enhanced Input", meta = (AllowPrivateAccess = "true"))
-	class UInputAction * InputStrafe;
+	TSoftObjectPtr<UInputAction> InputStrafe;
 
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Enhanced Input", meta = (AllowPrivateAccess = "true"))
-	class UInputAction * InputLookUp;
+	TSoftObjectPtr<UInputAction> InputLookUp;
 
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Enhanced Input", meta = (AllowPrivateAccess = "true"))
-	class UInputAction * InputLookRight;
+	TSoftObjectPtr<UInputAction> InputLookRight;
 
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Enhanced Input", meta = (AllowPrivateAccess = "true"))
-	class UInputAction * InputLockOn;
+	TSoftObjectPtr<UInputAction> InputLockOn;
 
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Enhanced Input", meta = (AllowPrivateAccess = "true"))
-	class UInputAction * InputCameraRightLockedOn;
+	TSoftObjectPtr<UInputAction> InputCameraRightLockedOn;
 
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Enhanced Input", meta = (AllowPrivateAccess = "true"))
-	class UInputAction * InputCameraLeftLockedOn;
+	TSoftObjectPtr<UInputAction> InputCameraLeftLockedOn;
 
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Enhanced Input", meta = (AllowPrivateAccess = "true"))
-	class UInputAction * InputRunDash;
+	TSoftObjectPtr<UInputAction> InputRunDash;
 
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Enhanced Input", meta = (AllowPrivateAccess = "true"))
-	class UInputAction * InputRoll;
+	TSoftObjectPtr<UInputAction> InputRoll;
 
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Enhanced Input", meta = (AllowPrivateAccess = "true"))
-	class UInputAction * InputAction;
+	TSoftObjectPtr<UInputAction> InputAction;
 
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Enhanced Input", meta = (AllowPrivateAccess = "true"))
-	class UInputAction * InputMoveLadder;
+	TSoftObjectPtr<UInputAction> InputMoveLadder;
 
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Enhanced Input", meta = (AllowPrivateAccess = "true"))
-	class UInputAction * InputStopMoveLadder;
+	TSoftObjectPtr<UInputAction> InputStopMoveLadder;
 
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Enhanced Input", meta = (AllowPrivateAccess = "true"))
-	class UInputAction * InputLightAttack;
+	TSoftObjectPtr<UInputAction> InputLightAttack;
 
 	void Move(const struct FInputActionValue & Value);
 	void Strafe(const struct FInputActionValue & Value);
@@ -101,13 +281,32 @@ private:
 	void ChangeCameraPositionWhenLockedOn(float DeltaTime);
 	void HandleCharacterRotation(float DeltaTime);
 	void HandleLockOnCamera(float DeltaTime);
+
+	// runs after movement and before the spring arm, so the arm places the camera with this frame's aim
+	friend struct FLockOnCameraTickFunction;
+	FLockOnCameraTickFunction LockOnCameraTick;
+	void TickLockOnCamera(float DeltaTime);
 	void DoTrace();
 	bool CheckForLadder();
 	void StopLadder();
 
+	struct FLockOnCandidate
+	{
+		TWeakObjectPtr<AActor> Actor;
+		float Angle;	// signed yaw from the camera, negative is to the left
+	};
+
+	void RefreshLockOnCandidates();
+	bool IsValidLockOnTarget(const AActor* Target, const FVector& CameraLocation) const;
+	float GetLockOnAngle(const AActor* Target) const;
+	bool SelectCenterLockOnTarget();
+	void ReleaseLockOn();
+
 	TArray<struct FHitResult> OutHits;
-	TArray<AActor*> NearestActors;
-	int32 ClosestEnemy = 0;
+	TArray<FLockOnCandidate> NearestActors;	// sorted by Angle
+	TWeakObjectPtr<AActor> LockedTarget;
+	int32 CandidateRefreshCursor = 0;
+	int32 TargetRegistryCursor = 0;
 
 	UPROPERTY()
 	class APlayerController* PlayerController;
@@ -121,14 +320,36 @@ private:
 	UPROPERTY(EditAnywhere)
 	class UCameraComponent* Camera;
 
+#if WITH_EDITORONLY_DATA
+	UPROPERTY(EditAnywhere)
+	class UAnimBlueprint* PlayerAnimBP;	// editor reference only, cooked builds use PlayerAnimClass
+#endif
+
 	UPROPERTY(EditAnywhere)
-	class UAnimBlueprint* PlayerAnimBP;
+	TSoftClassPtr<class UAnimInstance> PlayerAnimClass;
 
-	FTimerHandle RollTimer;
-	FTimerHandle RollCooldownTimer;
-	FTimerHandle StaminaRegenCooldown;
+	TSharedPtr<FStreamableHandle> CharacterAssetsHandle;
+	bool bInputBindingPending = false;
 
-	void DummyFun() {};
+	void RequestCharacterAssets();
+	void OnCharacterAssetsLoaded();
+	void BindInput(class UInputComponent* PlayerInputComponent);
+
+	FTimerHandle AttackTimer;
+	FTimerHandle StaggerTimer;
+
+	// roll timing and stamina regen, stepped with the world time from Tick
+	SLPCore::FRollSim RollSim;
+	SLPCore::FStaminaSim StaminaSim;
+
+	SLPCore::FRollRules GetRollRules() const;
+	SLPCore::FStaminaRules GetStaminaRules() const;
+
+	// mesh bones recorded with the capsule for hit validation, at most MaxHistoryHitboxes
+	UPROPERTY(EditAnywhere)
+	TArray<FName> HitboxBones;
+
+	FTransformHistory TransformHistory;
 
 	UPROPERTY(EditAnywhere)
 	float InvincibilityTime = 0.2f;
@@ -136,24 +357,30 @@ private:
 	UPROPERTY(EditAnywhere)
 	float RollCooldown = 0.2f;
 
+	UPROPERTY(EditAnywhere)
+	float AttackDuration = 0.5f;
+
+	float StaggerDuration;
+
 	float MoveAxisValue;
 	float StrafeAxisValue;
 	float MoveLadderValue;
 
 	bool bIsLockedOn;
 	bool bIsGrounded;
-	bool bIsPlayerRunning;
+	bool bWantsToSprint;
 	bool bResetCamera;
 	bool bCameraOnTheRightLockedOn;
-	bool bIsRolling;
-	bool bCanRoll;
-	bool bCanGoOnLadder;
+	bool bIsPooled;
 	
 	UPROPERTY(EditAnywhere)
 	float LockOnRange = 1000;
 
 	UPROPERTY(EditAnywhere)
 	float SweepRadius = 300;
+
+	UPROPERTY(EditAnywhere)
+	int32 LockOnRefreshBudget = 4;	// candidates revalidated and registry entries scanned per frame while locked on
 	
 	UPROPERTY(EditAnywhere)
 	float RunSpeed = 70.f;
@@ -178,11 +405,11 @@ private:
 
 	PlayerCurrentState CurrentState;
 
-	UPROPERTY(EditAnywhere)
+	UPROPERTY(EditAnywhere, ReplicatedUsing = OnRep_Health)
 	float Health;
 	UPROPERTY(EditAnywhere)
 	float MaxHealth = 100.f;
-	UPROPERTY(EditAnywhere)
+	UPROPERTY(EditAnywhere, ReplicatedUsing = OnRep_Stamina)
 	float Stamina;
 	UPROPERTY(EditAnywhere)
 	float MaxStamina = 100.f;
@@ -190,17 +417,24 @@ private:
 	float StaminaRegenRate = 10.f;
 	UPROPERTY(EditAnywhere)
 	float StaminaConsumptionRate = 20.f;
+	UPROPERTY(EditAnywhere, meta = (ClampMin = "0.0", ClampMax = "1.0"))
+	float DamageResistance = 0.f;	// fraction of incoming damage ignored
+	UPROPERTY(EditAnywhere)
+	float HitStaggerDuration = 0.f;	// 0 disables hit reactions
+	UPROPERTY(EditAnywhere)
+	float AttributeNotifyThreshold = 1.f;
 
-	void RegenStamina(float DeltaTime);
+	float LastNotifiedHealth;
+	float LastNotifiedStamina;
 
-	UFUNCTION(BlueprintCallable)
-	float GetStamina() const;
+	void SetHealth(float NewHealth);
+	void SetStamina(float NewStamina);
 
-	UFUNCTION(BlueprintCallable)
-	float GetHealth() const;
+	UFUNCTION()
+	void OnRep_Health();
 
-	UFUNCTION(BlueprintCallable)
-	bool GetIsRolling() const;
+	UFUNCTION()
+	void OnRep_Stamina();
 };
 
 	
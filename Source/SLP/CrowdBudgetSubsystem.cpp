@@ -0,0 +1,235 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CrowdBudgetSubsystem.h"
+
+#include "SLP.h"
+#include "BaseAIController.h"
+#include "BaseCharacter.h"
+#include "FrameScratchArena.h"
+#include "Engine/World.h"
+#include "GameFramework/Pawn.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/IConsoleManager.h"
+#include "Navigation/CrowdFollowingComponent.h"
+#include "Navigation/CrowdManager.h"
+
+DECLARE_CYCLE_STAT(TEXT("Crowd Budget Update"), STAT_CrowdBudgetUpdate, STATGROUP_SLP);
+DECLARE_CYCLE_STAT(TEXT("Crowd Separation"), STAT_CrowdSeparation, STATGROUP_SLP);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Crowd Simulated Agents"), STAT_CrowdSimulatedAgents, STATGROUP_SLP);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Crowd Separation Agents"), STAT_CrowdSeparationAgents, STATGROUP_SLP);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Crowd Nav Walking Agents"), STAT_CrowdNavWalkingAgents, STATGROUP_SLP);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Crowd Manager Agents"), STAT_CrowdManagerAgents, STATGROUP_SLP);
+
+// fraction of the nav walking distance an agent has to cross past it before switching, so agents on the boundary don't flip every update
+static constexpr float NavWalkingHysteresis = 0.1f;
+
+static TAutoConsoleVariable<int32> CVarCrowdMaxAgents(
+	TEXT("slp.Crowd.MaxAgents"), 40,
+	TEXT("Maximum number of AI agents simulated by the detour crowd, keep it below the crowd manager's MaxAgents."));
+
+static TAutoConsoleVariable<float> CVarCrowdUpdateInterval(
+	TEXT("slp.Crowd.UpdateInterval"), 0.5f,
+	TEXT("Seconds between crowd budget updates."));
+
+static TAutoConsoleVariable<float> CVarCrowdHighQualityDistance(
+	TEXT("slp.Crowd.HighQualityDistance"), 1000.f,
+	TEXT("Agents closer than this to a player use high avoidance quality."));
+
+static TAutoConsoleVariable<float> CVarCrowdGoodQualityDistance(
+	TEXT("slp.Crowd.GoodQualityDistance"), 2500.f,
+	TEXT("Agents closer than this to a player use good avoidance quality."));
+
+static TAutoConsoleVariable<float> CVarCrowdMediumQualityDistance(
+	TEXT("slp.Crowd.MediumQualityDistance"), 5000.f,
+	TEXT("Agents closer than this to a player use medium avoidance quality, further ones use low."));
+
+static TAutoConsoleVariable<float> CVarCrowdNavWalkingDistance(
+	TEXT("slp.Crowd.NavWalkingDistance"), 4000.f,
+	TEXT("Agents further than this from every player and out of combat move in nav walking mode, 0 disables the movement LOD."));
+
+static TAutoConsoleVariable<float> CVarCrowdSeparationRadius(
+	TEXT("slp.Crowd.SeparationRadius"), 120.f,
+	TEXT("Agents outside the crowd push away from each other inside this radius."));
+
+static TAutoConsoleVariable<float> CVarCrowdSeparationStrength(
+	TEXT("slp.Crowd.SeparationStrength"), 0.5f,
+	TEXT("Movement input scale of the separation push."));
+
+bool UCrowdBudgetSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game or WorldType == EWorldType::PIE;
+}
+
+TStatId UCrowdBudgetSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UCrowdBudgetSubsystem, STATGROUP_Tickables);
+}
+
+void UCrowdBudgetSubsystem::RegisterAgent(ABaseAIController* Controller)
+{
+	LLM_SCOPE_BYTAG(SLP_AI);
+
+	if(!Controller) return;
+
+	FCrowdAgentEntry& Entry = Agents.AddDefaulted_GetRef();
+	Entry.Controller = Controller;
+
+	// new agents stay outside the crowd until the next update finds room for them
+	Controller -> SetCrowdBudget(false, ECrowdAvoidanceQuality::Low);
+}
+
+void UCrowdBudgetSubsystem::UnregisterAgent(ABaseAIController* Controller)
+{
+	Agents.RemoveAllSwap([Controller](const FCrowdAgentEntry& Entry)
+	{
+		return Entry.Controller == Controller;
+	});
+}
+
+void UCrowdBudgetSubsystem::Tick(float DeltaTime)
+{
+	LLM_SCOPE_BYTAG(SLP_AI);
+
+	Super::Tick(DeltaTime);
+
+	TimeSinceUpdate += DeltaTime;
+	if(TimeSinceUpdate >= CVarCrowdUpdateInterval.GetValueOnGameThread())
+	{
+		TimeSinceUpdate = 0.f;
+		UpdateBudget();
+	}
+
+	ApplySeparation();
+}
+
+void UCrowdBudgetSubsystem::UpdateBudget()
+{
+	SCOPE_CYCLE_COUNTER(STAT_CrowdBudgetUpdate);
+
+	PlayerLocations.Reset();
+	for(FConstPlayerControllerIterator It = GetWorld() -> GetPlayerControllerIterator(); It; ++It)
+	{
+		if(const APawn* Pawn = It -> Get() ? It -> Get() -> GetPawn() : nullptr)
+		{
+			PlayerLocations.Add(Pawn -> GetActorLocation());
+		}
+	}
+
+	Agents.RemoveAllSwap([](const FCrowdAgentEntry& Entry)
+	{
+		return !Entry.Controller.IsValid();
+	});
+
+	for(FCrowdAgentEntry& Entry : Agents)
+	{
+		const APawn* Pawn = Entry.Controller -> GetPawn();
+		Entry.DistanceSquared = TNumericLimits<float>::Max();
+		if(!Pawn) continue;
+
+		for(const FVector& PlayerLocation : PlayerLocations)
+		{
+			Entry.DistanceSquared = FMath::Min(Entry.DistanceSquared, FVector::DistSquared(PlayerLocation, Pawn -> GetActorLocation()));
+		}
+	}
+
+	// nearest agents get the crowd, they are the ones a player can see bumping into each other
+	Agents.Sort([](const FCrowdAgentEntry& A, const FCrowdAgentEntry& B)
+	{
+		return A.DistanceSquared < B.DistanceSquared;
+	});
+
+	const int32 MaxAgents = CVarCrowdMaxAgents.GetValueOnGameThread();
+	const float HighSquared = FMath::Square(CVarCrowdHighQualityDistance.GetValueOnGameThread());
+	const float GoodSquared = FMath::Square(CVarCrowdGoodQualityDistance.GetValueOnGameThread());
+	const float MediumSquared = FMath::Square(CVarCrowdMediumQualityDistance.GetValueOnGameThread());
+	const float NavWalkingDistance = CVarCrowdNavWalkingDistance.GetValueOnGameThread();
+
+	int32 Simulated = 0;
+	int32 NavWalking = 0;
+	int32 Registered = 0;
+	const UCrowdManager* CrowdManager = UCrowdManager::GetCurrent(this);
+	for(int32 Index = 0; Index < Agents.Num(); ++Index)
+	{
+		FCrowdAgentEntry& Entry = Agents[Index];
+		Entry.bSimulated = Index < MaxAgents and Entry.Controller -> GetPawn();
+
+		ECrowdAvoidanceQuality::Type Quality = ECrowdAvoidanceQuality::Low;
+		if(Entry.DistanceSquared < HighSquared) Quality = ECrowdAvoidanceQuality::High;
+		else if(Entry.DistanceSquared < GoodSquared) Quality = ECrowdAvoidanceQuality::Good;
+		else if(Entry.DistanceSquared < MediumSquared) Quality = ECrowdAvoidanceQuality::Medium;
+
+		Entry.Controller -> SetCrowdBudget(Entry.bSimulated, Quality);
+		if(Entry.bSimulated) ++Simulated;
+
+		// the boundary is pushed away from the side the agent is on
+		const float Boundary = NavWalkingDistance * (Entry.bNavWalking ? 1.f - NavWalkingHysteresis : 1.f + NavWalkingHysteresis);
+		const bool bWantsNavWalking = NavWalkingDistance > 0.f and Entry.DistanceSquared > FMath::Square(Boundary) and !Entry.Controller -> IsInCombat() and !Entry.Controller -> IsTraversingNavLink();
+		ABaseCharacter* Character = Cast<ABaseCharacter>(Entry.Controller -> GetPawn());
+		Entry.bNavWalking = Character and Character -> SetNavWalkingLOD(bWantsNavWalking);	// what it actually does, a refused switch isn't counted
+		if(Entry.bNavWalking) ++NavWalking;
+
+		// agents still moving switch crowd state when their move ends, this is what the detour crowd actually holds
+		const UCrowdFollowingComponent* CrowdFollowing = Cast<UCrowdFollowingComponent>(Entry.Controller -> GetPathFollowingComponent());
+		if(CrowdManager and CrowdFollowing and CrowdManager -> IsAgentValid(CrowdFollowing)) ++Registered;
+	}
+
+	SET_DWORD_STAT(STAT_CrowdSimulatedAgents, Simulated);
+	SET_DWORD_STAT(STAT_CrowdSeparationAgents, Agents.Num() - Simulated);
+	SET_DWORD_STAT(STAT_CrowdNavWalkingAgents, NavWalking);
+	SET_DWORD_STAT(STAT_CrowdManagerAgents, Registered);
+}
+
+void UCrowdBudgetSubsystem::ApplySeparation()
+{
+	SCOPE_CYCLE_COUNTER(STAT_CrowdSeparation);
+
+	const float Radius = FMath::Max(CVarCrowdSeparationRadius.GetValueOnGameThread(), 1.f);
+	const float Strength = CVarCrowdSeparationStrength.GetValueOnGameThread();
+
+	// every agent goes in the grid, crowd agents still push the others away
+	SeparationGrid.Reset();
+	for(const FCrowdAgentEntry& Entry : Agents)
+	{
+		APawn* Pawn = Entry.Controller.IsValid() ? Entry.Controller -> GetPawn() : nullptr;
+		if(!Pawn) continue;
+
+		const FVector Location = Pawn -> GetActorLocation();
+		SeparationGrid.Add(FIntPoint(FMath::FloorToInt(Location.X / Radius), FMath::FloorToInt(Location.Y / Radius)), Pawn);
+	}
+
+	TArray<APawn*, FFrameScratchAllocator> Neighbours;
+	Neighbours.Reserve(16);
+	for(const FCrowdAgentEntry& Entry : Agents)
+	{
+		APawn* Pawn = Entry.bSimulated or !Entry.Controller.IsValid() ? nullptr : Entry.Controller -> GetPawn();
+		if(!Pawn) continue;
+
+		const FVector Location = Pawn -> GetActorLocation();
+		const FIntPoint Cell(FMath::FloorToInt(Location.X / Radius), FMath::FloorToInt(Location.Y / Radius));
+
+		FVector Push = FVector::ZeroVector;
+		for(int32 X = -1; X <= 1; ++X)
+		{
+			for(int32 Y = -1; Y <= 1; ++Y)
+			{
+				Neighbours.Reset();
+				SeparationGrid.MultiFind(Cell + FIntPoint(X, Y), Neighbours);
+				for(const APawn* Other : Neighbours)
+				{
+					if(Other == Pawn) continue;
+
+					FVector Away = Location - Other -> GetActorLocation();
+					Away.Z = 0.0;
+					const float Distance = Away.Size();
+					if(Distance < Radius and Distance > UE_KINDA_SMALL_NUMBER)
+					{
+						Push += Away / Distance * (1.f - Distance / Radius);
+					}
+				}
+			}
+		}
+
+		if(!Push.IsNearlyZero()) Pawn -> AddMovementInput(Push.GetClampedToMaxSize(1.f), Strength);
+	}
+}
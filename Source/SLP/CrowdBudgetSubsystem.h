@@ -0,0 +1,48 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "CrowdBudgetSubsystem.generated.h"
+
+class ABaseAIController;
+
+/**
+ * Hands out the crowd avoidance budget to the AI agents nearest to players, agents over the cap only get a cheap separation push.
+ * Agents far from every player and out of combat also drop to nav walking movement.
+ */
+UCLASS()
+class SLP_API UCrowdBudgetSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	void RegisterAgent(ABaseAIController* Controller);
+	void UnregisterAgent(ABaseAIController* Controller);
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	struct FCrowdAgentEntry
+	{
+		TWeakObjectPtr<ABaseAIController> Controller;
+		float DistanceSquared = 0.f;
+		bool bSimulated = false;
+		bool bNavWalking = false;
+	};
+
+	void UpdateBudget();
+	void ApplySeparation();
+
+	TArray<FCrowdAgentEntry> Agents;
+	TArray<FVector> PlayerLocations;
+
+	// rebuilt every frame, kept as a member so its storage is reused
+	TMultiMap<FIntPoint, APawn*> SeparationGrid;
+	float TimeSinceUpdate = 0.f;
+};
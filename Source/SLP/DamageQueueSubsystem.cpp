@@ -0,0 +1,104 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "DamageQueueSubsystem.h"
+
+#include "SLP.h"
+#include "BaseCharacter.h"
+#include "Engine/World.h"
+#include "Async/ParallelFor.h"
+
+DECLARE_CYCLE_STAT(TEXT("Damage Resolve"), STAT_DamageResolve, STATGROUP_SLP);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Damage Events"), STAT_DamageEvents, STATGROUP_SLP);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Damage Victims"), STAT_DamageVictims, STATGROUP_SLP);
+
+// below this many victims the arithmetic is cheaper than waking up workers
+static constexpr int32 MinVictimsForParallelResolve = 64;
+
+void FDamageQueueTickFunction::ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent)
+{
+	if(Subsystem) Subsystem -> ResolveDamage();
+}
+
+FString FDamageQueueTickFunction::DiagnosticMessage()
+{
+	return TEXT("FDamageQueueTickFunction");
+}
+
+bool UDamageQueueSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game or WorldType == EWorldType::PIE;
+}
+
+void UDamageQueueSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	// damage posted by anything ticking before or during physics is resolved the same frame
+	ResolveTickFunction.Subsystem = this;
+	ResolveTickFunction.bCanEverTick = true;
+	ResolveTickFunction.bStartWithTickEnabled = true;
+	ResolveTickFunction.TickGroup = TG_PostPhysics;
+	ResolveTickFunction.RegisterTickFunction(InWorld.PersistentLevel);
+}
+
+void UDamageQueueSubsystem::Deinitialize()
+{
+	if(ResolveTickFunction.IsTickFunctionRegistered()) ResolveTickFunction.UnRegisterTickFunction();
+	ResolveTickFunction.Subsystem = nullptr;
+
+	Super::Deinitialize();
+}
+
+void UDamageQueueSubsystem::QueueDamage(ABaseCharacter* Victim, float Amount)
+{
+	LLM_SCOPE_BYTAG(SLP_Combat);
+
+	if(!Victim or Amount <= 0.f) return;
+	PendingDamage.Add({ Victim, Amount });
+}
+
+void UDamageQueueSubsystem::ResolveDamage()
+{
+	LLM_SCOPE_BYTAG(SLP_Combat);
+
+	SCOPE_CYCLE_COUNTER(STAT_DamageResolve);
+	SET_DWORD_STAT(STAT_DamageEvents, PendingDamage.Num());
+	if(PendingDamage.IsEmpty()) return;
+
+	// sum the frame's damage per victim and take a snapshot of what the arithmetic needs
+	Victims.Reset();
+	VictimIndices.Reset();
+	for(const FQueuedDamage& Damage : PendingDamage)
+	{
+		ABaseCharacter* Victim = Damage.Victim.Get();
+		if(!Victim) continue;
+
+		if(const int32* Index = VictimIndices.Find(Victim))
+		{
+			Victims[*Index].RawDamage += Damage.Amount;
+			continue;
+		}
+		VictimIndices.Add(Victim, Victims.Num());
+		Victims.Add({ Victim, Victim -> GetHealth(), Victim -> GetDamageResistance(), Damage.Amount, 0.f, Victim -> GetIsRolling() });
+	}
+	PendingDamage.Reset();	// anything queued by the hit events below goes to the next frame
+
+	ParallelFor(Victims.Num(), [this](int32 Index)
+	{
+		FVictimDamage& Entry = Victims[Index];
+		if(Entry.bInvincible or Entry.Health <= 0.f) return;	// rolling i-frames, or already dead
+
+		const float Damage = Entry.RawDamage * (1.f - FMath::Clamp(Entry.Resistance, 0.f, 1.f));
+		Entry.AppliedDamage = FMath::Min(Entry.Health, Damage);	// health never goes below zero
+	}, Victims.Num() < MinVictimsForParallelResolve ? EParallelForFlags::ForceSingleThread : EParallelForFlags::None);
+
+	// hit and death events touch gameplay state, so they fire back on the game thread, an earlier death event may have destroyed a victim
+	for(const FVictimDamage& Entry : Victims)
+	{
+		ABaseCharacter* Victim = Entry.Victim.Get();
+		if(Victim and Entry.AppliedDamage > 0.f) Victim -> ApplyResolvedDamage(Entry.Health - Entry.AppliedDamage, Entry.AppliedDamage);
+	}
+
+	SET_DWORD_STAT(STAT_DamageVictims, Victims.Num());
+}
@@ -0,0 +1,74 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/EngineBaseTypes.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "DamageQueueSubsystem.generated.h"
+
+class ABaseCharacter;
+
+USTRUCT()
+struct FDamageQueueTickFunction : public FTickFunction
+{
+	GENERATED_BODY()
+
+	class UDamageQueueSubsystem* Subsystem = nullptr;
+
+	virtual void ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent) override;
+	virtual FString DiagnosticMessage() override;
+};
+
+template<>
+struct TStructOpsTypeTraits<FDamageQueueTickFunction> : public TStructOpsTypeTraitsBase2<FDamageQueueTickFunction>
+{
+	enum
+	{
+		WithCopy = false
+	};
+};
+
+/**
+ * Collects the damage posted during a frame and resolves it in one pass after physics
+ */
+UCLASS()
+class SLP_API UDamageQueueSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+
+	void QueueDamage(ABaseCharacter* Victim, float Amount);
+
+	void ResolveDamage();
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	struct FQueuedDamage
+	{
+		TWeakObjectPtr<ABaseCharacter> Victim;
+		float Amount;
+	};
+
+	// one per victim, filled on the game thread and resolved in parallel
+	struct FVictimDamage
+	{
+		TWeakObjectPtr<ABaseCharacter> Victim;
+		float Health;
+		float Resistance;
+		float RawDamage;
+		float AppliedDamage;
+		bool bInvincible;
+	};
+
+	FDamageQueueTickFunction ResolveTickFunction;
+
+	TArray<FQueuedDamage> PendingDamage;
+	TArray<FVictimDamage> Victims;
+	TMap<ABaseCharacter*, int32> VictimIndices;
+};
@@ -3,42 +3,54 @@
 
 #include "DamageTestActor.h"
 
+#include "SLP.h"
 #include "Kismet/GameplayStatics.h"
 #include "Components/BoxComponent.h"
 #include "BaseCharacter.h"
+#include "SignificanceComponent.h"
+#include "FrameScratchArena.h"
 
 // Sets default values
 ADamageTestActor::ADamageTestActor()
 {
+    LLM_SCOPE_BYTAG(SLP_Combat);
+
  	// Set this actor to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
 	PrimaryActorTick.bCanEverTick = true;
 
 	DamageTrigger = CreateDefaultSubobject<UBoxComponent>(TEXT("DamageTrigger"));
     DamageTrigger -> SetupAttachment(RootComponent);
+
+	Significance = CreateDefaultSubobject<USignificanceComponent>(TEXT("Significance"));
 }
 
 // Called when the game starts or when spawned
 void ADamageTestActor::BeginPlay()
 {
+    LLM_SCOPE_BYTAG(SLP_Combat);
+
 	Super::BeginPlay();
-	
 }
 
 // Called every frame
 void ADamageTestActor::Tick(float DeltaTime)
 {
+    LLM_SCOPE_BYTAG(SLP_Combat);
+
 	Super::Tick(DeltaTime);
 
-    TArray<AActor*> OverlappingActors;
-    DamageTrigger -> GetOverlappingActors(OverlappingActors, ABaseCharacter::StaticClass());
+    TArray<AActor*, FFrameScratchAllocator> OverlappingActors;
+    GetOverlappingActorsOfClass(DamageTrigger, OverlappingActors, ABaseCharacter::StaticClass());
 
     if(OverlappingActors.Num() > 0)
     {
         if(!GetWorldTimerManager().IsTimerActive(DamageTimer))
 		{
 			GetWorld() -> GetTimerManager().SetTimer(DamageTimer, this, &ADamageTestActor::NullFun, 2.f, false);
-			ABaseCharacter* PlayerCharacter = Cast<ABaseCharacter>(OverlappingActors[0]);
-	        PlayerCharacter -> ReceiveDamage(10.f);
+			for(AActor* Actor : OverlappingActors)	// everyone in the volume, queued and resolved together later this frame
+			{
+				Cast<ABaseCharacter>(Actor) -> ReceiveDamage(BaseDamage);
+			}
 		}    
     }
 }
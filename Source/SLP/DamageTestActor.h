@@ -29,6 +29,9 @@ public:
 	UPROPERTY(EditAnywhere)
 	class UBoxComponent* DamageTrigger;
 
+	UPROPERTY(VisibleAnywhere)
+	class USignificanceComponent* Significance;
+
 	FTimerHandle DamageTimer;
 	void NullFun();
 
@@ -2,38 +2,47 @@
 
 
 #include "DamageTestTrigger.h"
+#include "SLP.h"
 #include "Kismet/GameplayStatics.h"
 #include "Components/BoxComponent.h"
 #include "BaseCharacter.h"
+#include "SignificanceComponent.h"
+#include "FrameScratchArena.h"
 
 ADamageTestTrigger::ADamageTestTrigger()
 {
+    LLM_SCOPE_BYTAG(SLP_Combat);
+
     PrimaryActorTick.bCanEverTick = true;
 
     DamageTrigger = CreateDefaultSubobject<UBoxComponent>(TEXT("DamageTrigger"));
     DamageTrigger -> SetupAttachment(RootComponent);
+
+    Significance = CreateDefaultSubobject<USignificanceComponent>(TEXT("Significance"));
 }
 
 void ADamageTestTrigger::BeginPlay()
 {
+    LLM_SCOPE_BYTAG(SLP_Combat);
+
     Super::BeginPlay();
 }
 
 void ADamageTestTrigger::Tick(float DeltaTime)
 {
+    LLM_SCOPE_BYTAG(SLP_Combat);
+
     Super::Tick(DeltaTime);
 
-    TArray<AActor*> OverlappingActors;
-    DamageTrigger -> GetOverlappingActors(OverlappingActors, ABaseCharacter::StaticClass());
+    TArray<AActor*, FFrameScratchAllocator> OverlappingActors;
+    GetOverlappingActorsOfClass(DamageTrigger, OverlappingActors, ABaseCharacter::StaticClass());
 
     if(OverlappingActors.Num() > 0)
     {
-        ABaseCharacter* PlayerCharacter = Cast<ABaseCharacter>(OverlappingActors[0]);
-        PlayerCharacter -> ReceiveDamage(10.f);
-    }
-    else
-    {
-        UE_LOG(LogTemp, Warning, TEXT("no actors"));
+        for(AActor* Actor : OverlappingActors)    // everyone in the volume, queued and resolved together later this frame
+        {
+            Cast<ABaseCharacter>(Actor) -> ReceiveDamage(BaseDamage);
+        }
     }
 }
 
@@ -24,5 +24,8 @@ public:
 
 	UPROPERTY(EditAnywhere)
 	class UBoxComponent* DamageTrigger;
+
+	UPROPERTY(VisibleAnywhere)
+	class USignificanceComponent* Significance;
 	
 };
@@ -6,17 +6,52 @@
 #include "Components/BoxComponent.h"
 #include "Kismet/KismetMathLibrary.h"
 #include "BaseCharacter.h"
+#include "SignificanceComponent.h"
+#include "GameFramework/GameStateBase.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "Net/UnrealNetwork.h"
+#include "Net/Core/PushModel/PushModel.h"
+#include "PhysicsProxy/SingleParticlePhysicsProxy.h"
+#include "WorldPartition/WorldPartitionSubsystem.h"
+#include "PhysicsEngine/PhysicsSettings.h"
+#include "NavLinkCustomComponent.h"
+#include "Navigation/PathFollowingComponent.h"
+#include "BaseAIController.h"
+#include "SLP.h"
+
+static TAutoConsoleVariable<float> CVarElevatorStreamingActivateTime(
+	TEXT("slp.Elevator.StreamingActivateTime"), 2.f,
+	TEXT("Seconds before arrival at which the destination cells are activated at the highest priority, before that they are only loaded."));
+
+#if ENABLE_VISUAL_LOG
+static const TCHAR* ElevatorStateToString(ElevatorState State)
+{
+	switch (State)
+	{
+		case ElevatorState::Down:		return TEXT("Down");
+		case ElevatorState::Up:			return TEXT("Up");
+		case ElevatorState::MovingUp:	return TEXT("MovingUp");
+		case ElevatorState::MovingDown:	return TEXT("MovingDown");
+		default:						return TEXT("Invalid");
+	}
+}
+#endif
 
 // Sets default values
 AElevator::AElevator()
 {
+	LLM_SCOPE_BYTAG(SLP_Traversal);
+
 	// Set this actor to call Tick() every frame. You can turn this off to improve performance if you don't need it.
 	PrimaryActorTick.bCanEverTick = true;
 
-	CurrentState = ElevatorState::Down;
-	PreviousState = ElevatorState::Down;
+	// only state changes replicate, the movement itself is simulated on every machine
+	bReplicates = true;
+	SetReplicatingMovement(false);
+	NetDormancy = DORM_Initial;
 
 	ElevatorMesh = CreateDefaultSubobject<UStaticMeshComponent>(TEXT("ElevatorMesh"));
+	ElevatorMesh -> SetMobility(EComponentMobility::Movable);	// movable so characters standing on it use it as a moving base
 	RootComponent = ElevatorMesh;
 
 	TriggerMesh = CreateDefaultSubobject<UStaticMeshComponent>(TEXT("TriggerMesh"));
@@ -24,13 +59,45 @@ AElevator::AElevator()
 
 	ElevatorTrigger = CreateDefaultSubobject<UBoxComponent>(TEXT("ElevatorTrigger"));
 	ElevatorTrigger -> SetupAttachment(TriggerMesh);
-	
-	bIsElevatorTriggered = false;
+
+	// the moving platform stays out of the navmesh so it never dirties it, the links cross the shaft instead
+	ElevatorMesh -> SetCanEverAffectNavigation(false);
+	TriggerMesh -> SetCanEverAffectNavigation(false);
+	ElevatorTrigger -> SetCanEverAffectNavigation(false);
+
+	NavLinkUp = CreateDefaultSubobject<UNavLinkCustomComponent>(TEXT("NavLinkUp"));
+	NavLinkDown = CreateDefaultSubobject<UNavLinkCustomComponent>(TEXT("NavLinkDown"));
+
+	Significance = CreateDefaultSubobject<USignificanceComponent>(TEXT("Significance"));
 }
 
 // Called when the game starts or when spawned
 void AElevator::BeginPlay()
 {
+	LLM_SCOPE_BYTAG(SLP_Traversal);
+
+	// the project keeps async physics off, the option only works where it has been turned on
+	if(bUseAsyncPhysicsMove and !UPhysicsSettings::Get() -> bTickPhysicsAsync)
+	{
+		UE_LOG(LogSLP, Warning, TEXT("%s: bUseAsyncPhysicsMove needs Tick Physics Async in the physics settings, moving the platform on the game thread"), *GetName());
+		bUseAsyncPhysicsMove = false;
+	}
+
+	// only the server drives the body, clients follow the replicated move on the game thread
+	bMovesOnPhysicsThread = bUseAsyncPhysicsMove and HasAuthority();
+	if(bMovesOnPhysicsThread)
+	{
+		// the physics thread can't touch the component, it gets the handle, the kinematic target is synced back to the component
+		// so the trigger, the riders' base and the actor location follow the platform
+		ElevatorMesh -> BodyInstance.bUpdateKinematicFromSimulation = true;
+		FScopeLock Lock(&PhysicsMoveLock);
+		PhysicsMove.Handle = ElevatorMesh -> GetBodyInstance() -> GetPhysicsActorHandle();
+	}
+
+	// registration with the async physics tick happens in AActor::BeginPlay
+	bAsyncPhysicsTickEnabled = bMovesOnPhysicsThread;
+	Significance -> bRegisterOnBeginPlay = !bMovesOnPhysicsThread;	// nothing to throttle, it doesn't tick
+
 	Super::BeginPlay();
 	
 	// UE_LOG(LogTemp, Display, TEXT("start location: %s"), *StartLocation.ToString());
@@ -41,117 +108,420 @@ void AElevator::BeginPlay()
 		case true:
 			EndLocation = GetActorLocation();		
 			StartLocation = EndLocation + FVector(0, 0, -MoveDistance); 
-			CurrentState = ElevatorState::Up;
-			PreviousState = ElevatorState::Up;
 			break;
 		case false:
 			StartLocation = GetActorLocation();
 			EndLocation = StartLocation + FVector(0, 0, MoveDistance); 
-			CurrentState = ElevatorState::Down;
-			PreviousState = ElevatorState::Down;
 			break;
 	};
+
+	Sim.MoveDuration = MoveDuration;
+	Sim.Reset(ElevatorStartPosition);
+
+	ElevatorTrigger -> OnComponentBeginOverlap.AddDynamic(this, &AElevator::OnTriggerBeginOverlap);
+	ElevatorTrigger -> OnComponentEndOverlap.AddDynamic(this, &AElevator::OnTriggerEndOverlap);
+
+	// pick up whoever was already standing in the trigger
+	TArray<AActor*> OverlappingActors;
+	ElevatorTrigger -> GetOverlappingActors(OverlappingActors, ABaseCharacter::StaticClass());
+	for(AActor* Actor : OverlappingActors)
+	{
+		AddRider(Cast<ABaseCharacter>(Actor));
+	}
+
+	if(HasAuthority())
+	{
+		ReplicatedMove.State = (uint8)Sim.State;
+		MARK_PROPERTY_DIRTY_FROM_NAME(AElevator, ReplicatedMove, this);
+	}
+	else
+	{
+		ApplyReplicatedMove();	// the state may have arrived before the locations were known
+	}
+
+	PushPhysicsMove();
+
+	NavLinkUp -> SetMoveReachedLink(this, &AElevator::OnNavLinkReached);
+	NavLinkDown -> SetMoveReachedLink(this, &AElevator::OnNavLinkReached);
+	UpdateNavLinks();
+
+	// the physics thread moves the platform and the timer ends delays and moves, riders getting on or off step the rest
+	if(bMovesOnPhysicsThread) SetActorTickEnabled(false);
+
+	// only exists in partitioned worlds
+	UWorldPartitionSubsystem* WorldPartition = GetWorld() -> GetSubsystem<UWorldPartitionSubsystem>();
+	if(bStreamDestination and WorldPartition) WorldPartition -> RegisterStreamingSourceProvider(this);
+}
+
+void AElevator::PostInitializeComponents()
+{
+	Super::PostInitializeComponents();
+
+	// runs before any replicated value arrives, OnRep overwrites it once the server sends one
+	ReplicatedMove.State = (uint8)(ElevatorStartPosition ? ElevatorState::Up : ElevatorState::Down);
+}
+
+void AElevator::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	const TArray<TWeakObjectPtr<ABaseCharacter>> CurrentRiders = Riders;
+	for(const TWeakObjectPtr<ABaseCharacter>& Rider : CurrentRiders)
+	{
+		RemoveRider(Rider.Get());
+	}
+	Riders.Empty();
+
+	// the body goes away with the components, the physics thread stops using it from the next step
+	{
+		FScopeLock Lock(&PhysicsMoveLock);
+		PhysicsMove.Handle = nullptr;
+	}
+
+	if(UWorldPartitionSubsystem* WorldPartition = GetWorld() -> GetSubsystem<UWorldPartitionSubsystem>())
+	{
+		WorldPartition -> UnregisterStreamingSourceProvider(this);
+	}
+
+	Super::EndPlay(EndPlayReason);
 }
 
 // Called every frame
 void AElevator::Tick(float DeltaTime)
 {
+	LLM_SCOPE_BYTAG(SLP_Traversal);
+
 	Super::Tick(DeltaTime);
-	
-	if(DetectPlayer() and !bIsElevatorTriggered)
+
+	if(Sim.IsMoving())
 	{
-		UE_LOG(LogTemp, Warning, TEXT("Timer set! Activating elevator..."));
-		GetWorld() -> GetTimerManager().SetTimer(ActivationTimerHandle, this, &AElevator::MovePlatform, 1.0f, false);
-		bIsElevatorTriggered = true;
+		UE_VLOG(this, LogSLP, VeryVerbose, TEXT("%s"), ElevatorStateToString(Sim.State));	// keeps a snapshot per frame while moving
 	}
-	MovePlatform();
+
+	if(HasAuthority()) StepSimulation();	// clients only follow the replicated move
+	UpdatePlatformLocation();	// same time based move on every machine
 }
 
-bool AElevator::DetectPlayer()
+void AElevator::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
 {
-	TArray<AActor*> OverlappingActors;
-	ElevatorTrigger -> GetOverlappingActors(OverlappingActors, ABaseCharacter::StaticClass());
-	if(OverlappingActors.Num() > 0)
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	FDoRepLifetimeParams Params;
+	Params.bIsPushBased = true;
+	DOREPLIFETIME_WITH_PARAMS_FAST(AElevator, ReplicatedMove, Params);
+}
+
+void AElevator::StepSimulation()
+{
+	const ElevatorState OldState = Sim.State;
+	const bool bWasTriggered = Sim.bTriggered;
+	Sim.Step(GetServerWorldTime(), DetectPlayer());
+
+	if(Sim.bTriggered and !bWasTriggered)
 	{
-		for(AActor* Actor : OverlappingActors)
-		{
-			if(Actor -> ActorHasTag("Player"))
-			{
-				//UE_LOG(LogTemp, Warning, TEXT("Player detected!"));
-				return true;
-			} 
-		}
+		UE_VLOG(this, LogSLP, Log, TEXT("Player detected, activating elevator"));
 	}
-	return false;
+	if(Sim.State != OldState) OnStateChanged();
+	ScheduleSimulation();
+}
+
+void AElevator::OnStateChanged()
+{
+	// wake the actor for one update, it goes back to sleep right after
+	FlushNetDormancy();
+
+	ReplicatedMove.State = (uint8)Sim.State;
+	ReplicatedMove.StartServerTime = Sim.MoveStartTime;
+	MARK_PROPERTY_DIRTY_FROM_NAME(AElevator, ReplicatedMove, this);
+
+	PushPhysicsMove();
+	SnapToRestingLocation();	// a throttled tick may not have reached the end of the move
+	UpdateNavLinks();
 }
 
-void AElevator::MovePlatform()
+void AElevator::ScheduleSimulation()
 {
-	if(GetWorld()->GetTimerManager().IsTimerActive(ActivationTimerHandle))
+	const double Now = GetServerWorldTime();
+	const double NextEventTime = Sim.GetNextEventTime(Now);
+	FTimerManager& TimerManager = GetWorld() -> GetTimerManager();
+	if(NextEventTime < 0.0)
 	{
+		TimerManager.ClearTimer(SimulationTimerHandle);
 		return;
 	}
-	
-	switch (CurrentState)
+	if(NextEventTime == ScheduledEventTime and TimerManager.IsTimerActive(SimulationTimerHandle)) return;	// already waiting for it
+
+	ScheduledEventTime = NextEventTime;
+	TimerManager.SetTimer(SimulationTimerHandle, this, &AElevator::StepSimulation, FMath::Max((float)(NextEventTime - Now), KINDA_SMALL_NUMBER), false);
+}
+
+void AElevator::GetResourceSizeEx(FResourceSizeEx& CumulativeResourceSize)
+{
+	Super::GetResourceSizeEx(CumulativeResourceSize);
+
+	CumulativeResourceSize.AddDedicatedSystemMemoryBytes(Riders.GetAllocatedSize() + Passengers.GetAllocatedSize());
+}
+
+void AElevator::SerializeSnapshot(FArchive& Ar)
+{
+	uint8 SavedState = (uint8)Sim.State;
+	uint8 SavedPreviousState = (uint8)Sim.PreviousState;
+	float Progress = (float)Sim.GetProgress(GetServerWorldTime());
+	bool bSavedTriggered = Sim.bTriggered;
+	Ar << SavedState << SavedPreviousState << Progress << bSavedTriggered;
+	if(!Ar.IsLoading()) return;
+
+	// the start and end locations from BeginPlay are still valid, only the move is restored
+	Sim.Restore((ElevatorState)SavedState, (ElevatorState)SavedPreviousState, bSavedTriggered, Progress, GetServerWorldTime());
+	OnStateChanged();
+	UpdatePlatformLocation();
+	ScheduleSimulation();
+}
+
+bool AElevator::GetStreamingSources(TArray<FWorldPartitionStreamingSource>& OutStreamingSources) const
+{
+	if(!Sim.IsMoving() or Riders.IsEmpty()) return false;	// an empty elevator has nobody to stream for
+
+	// the move is time based, the destination and arrival time are known the moment it starts
+	const double Now = GetServerWorldTime();
+	const FVector Destination = Sim.State == ElevatorState::MovingUp ? EndLocation : StartLocation;
+	const double TimeToArrival = (1.0 - Sim.GetProgress(Now)) * MoveDuration;
+
+	// load early at high priority, activate and jump the queue close to arrival
+	const bool bArrivingSoon = TimeToArrival <= CVarElevatorStreamingActivateTime.GetValueOnGameThread();
+	FWorldPartitionStreamingSource& Source = OutStreamingSources.Emplace_GetRef(
+		GetFName(),
+		Destination,
+		GetActorRotation(),
+		bArrivingSoon ? EStreamingSourceTargetState::Activated : EStreamingSourceTargetState::Loaded,
+		false,
+		bArrivingSoon ? EStreamingSourcePriority::Highest : EStreamingSourcePriority::High,
+		false,
+		MoveDuration > 0.f ? MoveDistance / MoveDuration : 0.f);
+
+	if(DestinationStreamingRadius > 0.f)
+	{
+		FStreamingSourceShape& Shape = Source.Shapes.AddDefaulted_GetRef();
+		Shape.bUseGridLoadingRange = false;
+		Shape.Radius = DestinationStreamingRadius;
+	}
+	return true;
+}
+
+#if ENABLE_VISUAL_LOG
+void AElevator::GrabDebugSnapshot(FVisualLogEntry* Snapshot) const
+{
+	const bool bMoving = Sim.IsMoving();
+
+	FVisualLogStatusCategory Category(TEXT("SLP Elevator"));
+	Category.Add(TEXT("State"), ElevatorStateToString(Sim.State));
+	Category.Add(TEXT("Previous State"), ElevatorStateToString(Sim.PreviousState));
+	Category.Add(TEXT("Progress"), bMoving ? FString::Printf(TEXT("%.2f"), Sim.GetProgress(GetServerWorldTime())) : TEXT("-"));
+	Category.Add(TEXT("Triggered"), Sim.bTriggered ? TEXT("yes") : TEXT("no"));
+	Category.Add(TEXT("Riders"), FString::FromInt(Riders.Num()));
+	Snapshot -> Status.Add(Category);
+
+	Snapshot -> AddSegment(StartLocation, EndLocation, LogSLP.GetCategoryName(), ELogVerbosity::Log, FColor::Cyan, TEXT("travel"));
+	Snapshot -> AddLocation(GetActorLocation(), LogSLP.GetCategoryName(), ELogVerbosity::Log, bMoving ? FColor::Green : FColor::White, ElevatorStateToString(Sim.State), 20);
+}
+#endif
+
+void AElevator::OnRep_ReplicatedMove()
+{
+	if(HasActorBegunPlay()) ApplyReplicatedMove();
+}
+
+void AElevator::ApplyReplicatedMove()
+{
+	Sim.State = (ElevatorState)ReplicatedMove.State;
+	Sim.MoveStartTime = ReplicatedMove.StartServerTime;
+	PushPhysicsMove();
+
+	SnapToRestingLocation();
+	UpdatePlatformLocation();
+}
+
+void AElevator::SnapToRestingLocation()
+{
+	switch (Sim.State)
 	{
 		case ElevatorState::Down:
-		if(bIsElevatorTriggered)
-		{
-			if(PreviousState == ElevatorState::MovingDown)	break;	// if the player stays on the elevator, it won't trigger again
-			GetWorld()->GetTimerManager().SetTimer(MoveTimerHandle, this, &AElevator::OnElevatorMoveFinished, MoveDuration, false);
-			CurrentState = ElevatorState::MovingUp;
-			PreviousState = ElevatorState::Down;
-		}
-		else
-		{
-			PreviousState = CurrentState;
-		}
-		break;
-		case ElevatorState::Up:
-		if(bIsElevatorTriggered)
-		{
-			if(PreviousState == ElevatorState::MovingUp)	break;	// if the player stays on the elevator, it won't trigger again
-			GetWorld()->GetTimerManager().SetTimer(MoveTimerHandle, this, &AElevator::OnElevatorMoveFinished, MoveDuration, false);
-			CurrentState = ElevatorState::MovingDown;
-			PreviousState = ElevatorState::Up;
-		}
-		else
-		{
-			PreviousState = CurrentState;
-		}
-		break;
-		case ElevatorState::MovingUp:
-		{
-			float ElapsedTime = GetWorld()->GetTimerManager().GetTimerElapsed(MoveTimerHandle);
-			float Alpha = ElapsedTime / MoveDuration;
-			SetActorLocation(FMath::Lerp(StartLocation, EndLocation, Alpha));
+			SetActorLocation(StartLocation);
 			break;
-		}
-		case ElevatorState::MovingDown:
-		{
-			UE_LOG(LogTemp, Warning, TEXT("moving down state"));
-			float ElapsedTime = GetWorld()->GetTimerManager().GetTimerElapsed(MoveTimerHandle);
-			float Alpha = ElapsedTime / MoveDuration;
-			SetActorLocation(FMath::Lerp(EndLocation, StartLocation, Alpha));
+		case ElevatorState::Up:
+			SetActorLocation(EndLocation);
 			break;
-		}
 		default:
 			break;
 	}
 }
 
-void AElevator::OnElevatorMoveFinished()
+void AElevator::UpdatePlatformLocation()
+{
+	if(bMovesOnPhysicsThread or !Sim.IsMoving()) return;	// the physics thread moves the platform
+
+	SetActorLocation(FMath::Lerp(StartLocation, EndLocation, Sim.GetHeightAlpha(GetServerWorldTime())));
+}
+
+void AElevator::PushPhysicsMove()
+{
+	if(!bMovesOnPhysicsThread) return;
+
+	FScopeLock Lock(&PhysicsMoveLock);
+	PhysicsMove.bMoving = Sim.IsMoving();
+	PhysicsMove.From = Sim.State == ElevatorState::MovingUp or Sim.State == ElevatorState::Down ? StartLocation : EndLocation;
+	PhysicsMove.To = Sim.State == ElevatorState::MovingDown or Sim.State == ElevatorState::Down ? StartLocation : EndLocation;
+	PhysicsMove.StartAlpha = PhysicsMove.bMoving ? (float)Sim.GetProgress(GetServerWorldTime()) : 1.f;
+	PhysicsMove.Duration = FMath::Max(MoveDuration, KINDA_SMALL_NUMBER);
+	++PhysicsMove.Serial;
+}
+
+void AElevator::AsyncPhysicsTickActor(float DeltaTime, float SimTime)
+{
+	Super::AsyncPhysicsTickActor(DeltaTime, SimTime);
+
+	FPhysicsMove Move;
+	{
+		FScopeLock Lock(&PhysicsMoveLock);
+		Move = PhysicsMove;
+	}
+
+	// a new move restarts from where the game thread says it is, after that it advances in fixed physics steps
+	if(Move.Serial != PhysicsSerial)
+	{
+		PhysicsSerial = Move.Serial;
+		PhysicsAlpha = Move.StartAlpha;
+	}
+	if(Move.bMoving) PhysicsAlpha = FMath::Min(PhysicsAlpha + DeltaTime / Move.Duration, 1.f);
+
+	Chaos::FRigidBodyHandle_Internal* Rigid = Move.Handle ? Move.Handle -> GetPhysicsThreadAPI() : nullptr;
+	if(!Rigid) return;
+
+	const FTransform Target(FQuat(Rigid -> R()), FMath::Lerp(Move.From, Move.To, PhysicsAlpha));
+	Rigid -> SetKinematicTarget(Chaos::FKinematicTarget::MakePositionTarget(Target));
+}
+
+double AElevator::GetServerWorldTime() const
+{
+	const AGameStateBase* GameState = GetWorld() -> GetGameState();
+	return GameState ? GameState -> GetServerWorldTimeSeconds() : GetWorld() -> GetTimeSeconds();
+}
+
+void AElevator::OnTriggerBeginOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult)
+{
+	AddRider(Cast<ABaseCharacter>(OtherActor));
+}
+
+void AElevator::OnTriggerEndOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex)
+{
+	// a character overlaps with more than one component, it only leaves when the last one does
+	if(ElevatorTrigger -> IsOverlappingActor(OtherActor)) return;
+	RemoveRider(Cast<ABaseCharacter>(OtherActor));
+}
+
+void AElevator::AddRider(ABaseCharacter* Rider)
+{
+	if(!Rider or Riders.Contains(Rider)) return;
+	Riders.Add(Rider);
+	OnRidersChanged();
+
+	// the platform moves first, the rider's movement then applies the base delta in its own update
+	Rider -> PrimaryActorTick.AddPrerequisite(this, PrimaryActorTick);
+	Rider -> GetCharacterMovement() -> PrimaryComponentTick.AddPrerequisite(this, PrimaryActorTick);
+}
+
+void AElevator::RemoveRider(ABaseCharacter* Rider)
+{
+	if(!Rider or Riders.Remove(Rider) == 0) return;
+	OnRidersChanged();
+
+	Rider -> PrimaryActorTick.RemovePrerequisite(this, PrimaryActorTick);
+	Rider -> GetCharacterMovement() -> PrimaryComponentTick.RemovePrerequisite(this, PrimaryActorTick);
+}
+
+void AElevator::OnRidersChanged()
+{
+	// without a tick the trigger is only looked at when someone gets on or off, a timer so it never runs inside the overlap events or EndPlay
+	if(bMovesOnPhysicsThread) GetWorldTimerManager().SetTimerForNextTick(this, &AElevator::StepSimulation);
+}
+
+bool AElevator::DetectPlayer()
+{
+	// the rider list is kept by the trigger events, no overlap query needed
+	for(const TWeakObjectPtr<ABaseCharacter>& Rider : Riders)
+	{
+		if(Rider.IsValid() and (Rider -> ActorHasTag("Player") or Passengers.Contains(Rider)))
+		{
+			//UE_LOG(LogTemp, Warning, TEXT("Player detected!"));
+			return true;
+		} 
+	}
+	return false;
+}
+
+void AElevator::OnConstruction(const FTransform& Transform)
+{
+	Super::OnConstruction(Transform);
+
+	// the same stops BeginPlay derives, relative to where the elevator is placed
+	const FVector Bottom = ElevatorStartPosition ? FVector(0, 0, -MoveDistance) : FVector::ZeroVector;
+	const FVector Top = ElevatorStartPosition ? FVector::ZeroVector : FVector(0, 0, MoveDistance);
+	NavLinkUp -> SetLinkData(Bottom + NavLinkExitOffset, Top + NavLinkExitOffset, ENavLinkDirection::LeftToRight);
+	NavLinkDown -> SetLinkData(Top + NavLinkExitOffset, Bottom + NavLinkExitOffset, ENavLinkDirection::LeftToRight);
+}
+
+void AElevator::UpdateNavLinks()
+{
+	if(!HasAuthority()) return;	// AI only paths on the server
+
+	// only flips the link's area in the navmesh, nothing is rebuilt
+	const bool bUpEnabled = Sim.State == ElevatorState::Down;
+	const bool bDownEnabled = Sim.State == ElevatorState::Up;
+	if(NavLinkUp -> IsEnabled() != bUpEnabled) NavLinkUp -> SetEnabled(bUpEnabled);
+	if(NavLinkDown -> IsEnabled() != bDownEnabled) NavLinkDown -> SetEnabled(bDownEnabled);
+}
+
+void AElevator::OnNavLinkReached(UNavLinkCustomComponent* Link, UObject* PathingAgent, const FVector& DestPoint)
 {
-	if (CurrentState == ElevatorState::MovingUp)
+	UPathFollowingComponent* PathFollowing = Cast<UPathFollowingComponent>(PathingAgent);
+	ABaseAIController* Controller = PathFollowing ? Cast<ABaseAIController>(PathFollowing -> GetOwner()) : nullptr;
+	if(!Controller)
 	{
-		CurrentState = ElevatorState::Up;
-		PreviousState = ElevatorState::MovingUp;
-		bIsElevatorTriggered = false;
+		if(PathFollowing) PathFollowing -> FinishUsingCustomLink(Link);	// nothing to drive the ride, don't leave the move paused
+		return;
 	}
-	else if (CurrentState == ElevatorState::MovingDown)
+	Controller -> BeginNavLinkTraversal(this, Link, DestPoint);
+}
+
+bool AElevator::IsRestingAt(bool bTop) const
+{
+	return Sim.State == (bTop ? ElevatorState::Up : ElevatorState::Down);
+}
+
+void AElevator::CallTo(bool bTop)
+{
+	if(!HasAuthority()) return;
+
+	const bool bWasTriggered = Sim.bTriggered;
+	Sim.Call(bTop, GetServerWorldTime());
+	if(Sim.bTriggered and !bWasTriggered)
 	{
-		CurrentState = ElevatorState::Down;
-		PreviousState = ElevatorState::MovingDown;
-		bIsElevatorTriggered = false;
+		UE_VLOG(this, LogSLP, Log, TEXT("Called to the %s"), bTop ? TEXT("top") : TEXT("bottom"));
+		ScheduleSimulation();
 	}
-}
\ No newline at end of file
+}
+
+bool AElevator::IsCarrying(const ABaseCharacter* Character) const
+{
+	return Riders.Contains(Character);
+}
+
+void AElevator::AddPassenger(ABaseCharacter* Passenger)
+{
+	if(!Passenger or Passengers.Contains(Passenger)) return;
+	Passengers.Add(Passenger);
+	OnRidersChanged();
+}
+
+void AElevator::RemovePassenger(ABaseCharacter* Passenger)
+{
+	if(Passengers.Remove(Passenger) > 0) OnRidersChanged();
+}
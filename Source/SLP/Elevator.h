@@ -4,18 +4,29 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
+#include "VisualLogger/VisualLoggerDebugSnapshotInterface.h"
+#include "WorldPartition/WorldPartitionStreamingSource.h"
+#include "PhysicsInterfaceDeclaresCore.h"
+#include "SimulationCore.h"
 #include "Elevator.generated.h"
 
-enum class ElevatorState
+using ElevatorState = SLPCore::EElevatorState;
+
+// the only thing clients get, the position is rebuilt from it with the synchronized server time
+USTRUCT()
+struct FElevatorReplicatedMove
 {
-	Down,
-	Up,
-	MovingUp,
-	MovingDown
+	GENERATED_BODY()
+
+	UPROPERTY()
+	uint8 State = 0;
+
+	UPROPERTY()
+	double StartServerTime = 0.0;
 };
 
 UCLASS()
-class SLP_API AElevator : public AActor
+class SLP_API AElevator : public AActor, public IVisualLoggerDebugSnapshotInterface, public IWorldPartitionStreamingSourceProvider
 {
 	GENERATED_BODY()
 	
@@ -27,9 +38,44 @@ protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
 
+	// seeds the replicated state from the start position, a dormant elevator may never send it before its first ride
+	virtual void PostInitializeComponents() override;
+
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 public:	
 	// Called every frame
 	virtual void Tick(float DeltaTime) override;
+
+	// fixed rate physics step, drives the platform as a kinematic target when bUseAsyncPhysicsMove is set
+	virtual void AsyncPhysicsTickActor(float DeltaTime, float SimTime) override;
+
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
+	// adds the rider lists, they aren't properties so slp.Memory.Dump doesn't count them otherwise
+	virtual void GetResourceSizeEx(FResourceSizeEx& CumulativeResourceSize) override;
+
+	// places the nav links at both stops while the elevator is edited
+	virtual void OnConstruction(const FTransform& Transform) override;
+
+	// AI rides, started when the path reaches a nav link and driven by the AI controller
+	bool IsRestingAt(bool bTop) const;
+	void CallTo(bool bTop);
+	bool IsCarrying(const class ABaseCharacter* Character) const;
+	void AddPassenger(class ABaseCharacter* Passenger);
+	void RemovePassenger(class ABaseCharacter* Passenger);
+
+	// writes or reads (Ar.IsLoading()) the state kept in world snapshots
+	void SerializeSnapshot(FArchive& Ar);
+
+	// while a rider is carried, the cells at the destination are requested ahead of arrival
+	virtual bool GetStreamingSources(TArray<FWorldPartitionStreamingSource>& OutStreamingSources) const override;
+	virtual const UObject* GetStreamingSourceOwner() const override { return this; }
+
+#if ENABLE_VISUAL_LOG
+	// state, move progress and riders, shown by the visual logger and the SLP gameplay debugger category
+	virtual void GrabDebugSnapshot(FVisualLogEntry* Snapshot) const override;
+#endif
 	
 private:
 	UPROPERTY(EditAnywhere)
@@ -41,14 +87,63 @@ private:
 	UPROPERTY(EditAnywhere)
 	class UBoxComponent* ElevatorTrigger;
 
-	ElevatorState CurrentState;
-	ElevatorState PreviousState;
+	UPROPERTY(VisibleAnywhere)
+	class USignificanceComponent* Significance;
+
+	// state, trigger and move timing, the actor only applies what the simulation decides
+	SLPCore::FElevatorSim Sim;
+
+	UPROPERTY(ReplicatedUsing = OnRep_ReplicatedMove)
+	FElevatorReplicatedMove ReplicatedMove;
+
+	UFUNCTION()
+	void OnRep_ReplicatedMove();
+
+	// server only, advances the simulation and publishes a state change
+	void StepSimulation();
+	void OnRidersChanged();
+	void OnStateChanged();
+
+	// a throttled or dormant tick still has to end the activation delay and the move on time
+	void ScheduleSimulation();
+	FTimerHandle SimulationTimerHandle;
+	double ScheduledEventTime = -1.0;
+
+	void ApplyReplicatedMove();
+	void SnapToRestingLocation();
+	void UpdatePlatformLocation();
+	double GetServerWorldTime() const;
+
+	UFUNCTION()
+	void OnTriggerBeginOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult);
+
+	UFUNCTION()
+	void OnTriggerEndOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex);
+
+	void AddRider(class ABaseCharacter* Rider);
+	void RemoveRider(class ABaseCharacter* Rider);
+
+	// characters inside the trigger, they tick after the platform so they are carried by this frame's move
+	TArray<TWeakObjectPtr<class ABaseCharacter>> Riders;
+
+	// AI that boarded through a nav link, they trigger the elevator like a player does
+	TArray<TWeakObjectPtr<class ABaseCharacter>> Passengers;
+
+	// one link per direction, only the one leaving the stop the platform rests at is enabled so paths never wait on a moving platform
+	UPROPERTY(VisibleAnywhere)
+	class UNavLinkCustomComponent* NavLinkUp;
+
+	UPROPERTY(VisibleAnywhere)
+	class UNavLinkCustomComponent* NavLinkDown;
+
+	// where walkers wait and leave at each stop, relative to the platform, has to be on the navmesh next to the shaft
+	UPROPERTY(EditAnywhere)
+	FVector NavLinkExitOffset = FVector(200.f, 0.f, 0.f);
+
+	void UpdateNavLinks();
+	void OnNavLinkReached(class UNavLinkCustomComponent* Link, UObject* PathingAgent, const FVector& DestPoint);
 
 	bool DetectPlayer();
-	void MovePlatform();
-	void OnElevatorMoveFinished();
-	FTimerHandle MoveTimerHandle;
-	FTimerHandle ActivationTimerHandle;
 
 	UPROPERTY(EditAnywhere)
 	bool ElevatorStartPosition = false;	// up (true) or down (false)
@@ -59,10 +154,45 @@ private:
 	UPROPERTY(EditAnywhere)
 	float MoveDuration = 5.f;
 
+	// move the platform on the physics thread instead of teleporting it from the game thread, the mesh follows the interpolated physics results
+	// and the actor doesn't tick on the server, needs Tick Physics Async in the project's physics settings
+	UPROPERTY(EditAnywhere)
+	bool bUseAsyncPhysicsMove = false;
+
+	// register as a World Partition streaming source at the destination while moving
+	UPROPERTY(EditAnywhere)
+	bool bStreamDestination = true;
+
+	// 0 uses the loading range of the streaming grids
+	UPROPERTY(EditAnywhere, meta=(EditCondition="bStreamDestination"))
+	float DestinationStreamingRadius = 0.f;
+
+	// what the physics thread needs to follow the move, copied under PhysicsMoveLock whenever the state changes
+	struct FPhysicsMove
+	{
+		FVector From = FVector::ZeroVector;
+		FVector To = FVector::ZeroVector;
+		float StartAlpha = 0.f;
+		float Duration = 1.f;
+		bool bMoving = false;
+		uint32 Serial = 0;
+		FPhysicsActorHandle Handle = nullptr;	// cached on the game thread, cleared in EndPlay
+	};
+
+	void PushPhysicsMove();
+
+	// bUseAsyncPhysicsMove on the server with async physics available, clients and the fallback move on the game thread
+	bool bMovesOnPhysicsThread = false;
+
+	FPhysicsMove PhysicsMove;
+	FCriticalSection PhysicsMoveLock;
+
+	// physics thread only
+	float PhysicsAlpha = 0.f;
+	uint32 PhysicsSerial = 0;
+
 	FVector StartLocation;
 	FVector EndLocation;
 
-	bool bIsElevatorTriggered;;
-
 	void AnimateTrigger();
 };
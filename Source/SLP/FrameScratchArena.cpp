@@ -0,0 +1,86 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "FrameScratchArena.h"
+
+#include "SLP.h"
+#include "Misc/CoreDelegates.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Frame Scratch Bytes"), STAT_FrameScratchBytes, STATGROUP_SLP);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Frame Scratch Overflow Allocs"), STAT_FrameScratchOverflowAllocs, STATGROUP_SLP);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Frame Scratch Peak Bytes"), STAT_FrameScratchPeakBytes, STATGROUP_SLP);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Frame Scratch Block Bytes"), STAT_FrameScratchBlockBytes, STATGROUP_SLP);
+
+static constexpr SIZE_T InitialScratchBlockSize = 64 * 1024;
+
+FFrameScratchArena& FFrameScratchArena::Get()
+{
+	static FFrameScratchArena Arena;
+	static bool bRegistered = false;
+	if(!bRegistered)
+	{
+		bRegistered = true;
+		FCoreDelegates::OnEndFrame.AddStatic([]() { FFrameScratchArena::Get().Reset(); });
+	}
+	return Arena;
+}
+
+FFrameScratchArena::~FFrameScratchArena()
+{
+	for(void* Allocation : Overflow) FMemory::Free(Allocation);
+	FMemory::Free(Block);
+}
+
+void* FFrameScratchArena::Allocate(SIZE_T Size, uint32 Alignment)
+{
+	LLM_SCOPE_BYTAG(SLP);
+
+	check(IsInGameThread());
+
+	if(!Block)
+	{
+		BlockSize = InitialScratchBlockSize;
+		Block = (uint8*)FMemory::Malloc(BlockSize, PLATFORM_CACHE_LINE_SIZE);
+		SET_DWORD_STAT(STAT_FrameScratchBlockBytes, BlockSize);
+	}
+
+	BytesThisFrame += Size;
+
+	const SIZE_T Start = Align(Offset, Alignment);
+	if(Start + Size <= BlockSize)
+	{
+		Offset = Start + Size;
+		return Block + Start;
+	}
+
+	// out of room this frame, the block is resized to fit the peak on reset
+	void* Allocation = FMemory::Malloc(Size, Alignment);
+	Overflow.Add(Allocation);
+	return Allocation;
+}
+
+void FFrameScratchArena::Reset()
+{
+	check(IsInGameThread());
+
+	SET_DWORD_STAT(STAT_FrameScratchBytes, BytesThisFrame);
+	SET_DWORD_STAT(STAT_FrameScratchOverflowAllocs, Overflow.Num());
+
+	PeakBytes = FMath::Max(PeakBytes, BytesThisFrame);
+	SET_DWORD_STAT(STAT_FrameScratchPeakBytes, PeakBytes);
+
+	for(void* Allocation : Overflow) FMemory::Free(Allocation);
+	if(!Overflow.IsEmpty())
+	{
+		// padding between allocations isn't in the byte count, leave room for it
+		FMemory::Free(Block);
+		BlockSize = FMath::RoundUpToPowerOfTwo64(PeakBytes + PeakBytes / 4);
+		Block = (uint8*)FMemory::Malloc(BlockSize, PLATFORM_CACHE_LINE_SIZE);
+		SET_DWORD_STAT(STAT_FrameScratchBlockBytes, BlockSize);
+	}
+	Overflow.Reset();
+
+	Offset = 0;
+	BytesThisFrame = 0;
+	++Frame;
+}
@@ -0,0 +1,143 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/PrimitiveComponent.h"
+
+/**
+ * Game thread linear arena for per-frame scratch memory, everything allocated from it is released together at the end of the frame.
+ * The block grows to the frame's peak use, so after a few frames allocations never reach malloc.
+ */
+class SLP_API FFrameScratchArena
+{
+public:
+	static FFrameScratchArena& Get();
+
+	void* Allocate(SIZE_T Size, uint32 Alignment);
+
+	// called at the end of every frame, nothing allocated before it may be used after it
+	void Reset();
+
+	uint64 GetFrame() const { return Frame; }
+	SIZE_T GetBytesThisFrame() const { return BytesThisFrame; }
+	SIZE_T GetPeakBytes() const { return PeakBytes; }
+
+private:
+	FFrameScratchArena() = default;
+	~FFrameScratchArena();
+
+	uint8* Block = nullptr;
+	SIZE_T BlockSize = 0;
+	SIZE_T Offset = 0;
+
+	// allocations that didn't fit in the block this frame, freed on reset
+	TArray<void*> Overflow;
+
+	SIZE_T BytesThisFrame = 0;
+	SIZE_T PeakBytes = 0;
+	uint64 Frame = 0;
+};
+
+/**
+ * TArray allocator backed by FFrameScratchArena, only for locals that don't outlive the frame.
+ * Growing copies into a new arena allocation and abandons the old one, reserve up front where the size is known.
+ */
+class FFrameScratchAllocator
+{
+public:
+	using SizeType = int32;
+
+	enum { NeedsElementType = true };
+	enum { RequireRangeCheck = true };
+
+	template<typename ElementType>
+	class ForElementType
+	{
+	public:
+		ForElementType() = default;
+
+		FORCEINLINE void MoveToEmpty(ForElementType& Other)
+		{
+			checkSlow(this != &Other);
+			Data = Other.Data;
+			Frame = Other.Frame;
+			Other.Data = nullptr;
+		}
+
+		FORCEINLINE ElementType* GetAllocation() const
+		{
+			checkSlow(!Data or Frame == FFrameScratchArena::Get().GetFrame());	// used after the frame ended
+			return Data;
+		}
+
+		void ResizeAllocation(SizeType CurrentNum, SizeType NewMax, SIZE_T NumBytesPerElement)
+		{
+			ElementType* OldData = Data;
+			Data = nullptr;
+			if(NewMax)
+			{
+				Data = (ElementType*)FFrameScratchArena::Get().Allocate(NewMax * NumBytesPerElement, FMath::Max((uint32)alignof(ElementType), (uint32)DEFAULT_ALIGNMENT));
+				Frame = FFrameScratchArena::Get().GetFrame();
+				if(OldData and CurrentNum)
+				{
+					FMemory::Memcpy(Data, OldData, FMath::Min(NewMax, CurrentNum) * NumBytesPerElement);
+				}
+			}
+		}
+
+		FORCEINLINE SizeType CalculateSlackReserve(SizeType NewMax, SIZE_T NumBytesPerElement) const
+		{
+			return DefaultCalculateSlackReserve(NewMax, NumBytesPerElement, false, alignof(ElementType));
+		}
+
+		FORCEINLINE SizeType CalculateSlackShrink(SizeType NewMax, SizeType CurrentMax, SIZE_T NumBytesPerElement) const
+		{
+			return DefaultCalculateSlackShrink(NewMax, CurrentMax, NumBytesPerElement, false, alignof(ElementType));
+		}
+
+		FORCEINLINE SizeType CalculateSlackGrow(SizeType NewMax, SizeType CurrentMax, SIZE_T NumBytesPerElement) const
+		{
+			return DefaultCalculateSlackGrow(NewMax, CurrentMax, NumBytesPerElement, false, alignof(ElementType));
+		}
+
+		SIZE_T GetAllocatedSize(SizeType CurrentMax, SIZE_T NumBytesPerElement) const
+		{
+			return CurrentMax * NumBytesPerElement;
+		}
+
+		bool HasAllocation() const
+		{
+			return !!Data;
+		}
+
+		SizeType GetInitialCapacity() const
+		{
+			return 0;
+		}
+
+	private:
+		ElementType* Data = nullptr;
+		uint64 Frame = 0;
+	};
+
+	typedef ForElementType<FScriptContainerElement> ForAnyElementType;
+};
+
+template <>
+struct TAllocatorTraits<FFrameScratchAllocator> : TAllocatorTraitsBase<FFrameScratchAllocator>
+{
+	enum { SupportsMove = true };
+};
+
+// GetOverlappingActors for any allocator, read straight from the component's overlap list
+template<typename AllocatorType>
+void GetOverlappingActorsOfClass(const UPrimitiveComponent* Component, TArray<AActor*, AllocatorType>& OutActors, const UClass* ClassFilter)
+{
+	OutActors.Reset();
+	for(const FOverlapInfo& Overlap : Component -> GetOverlapInfos())
+	{
+		AActor* Actor = Overlap.OverlapInfo.GetActor();
+		if(IsValid(Actor) and (!ClassFilter or Actor -> IsA(ClassFilter))) OutActors.AddUnique(Actor);
+	}
+}
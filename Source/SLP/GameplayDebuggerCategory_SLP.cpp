@@ -0,0 +1,81 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GameplayDebuggerCategory_SLP.h"
+
+#if WITH_GAMEPLAY_DEBUGGER
+
+#include "Elevator.h"
+#include "Ladder.h"
+#include "EngineUtils.h"
+#include "GameFramework/Pawn.h"
+#include "GameFramework/PlayerController.h"
+#include "VisualLogger/VisualLogger.h"
+#include "VisualLogger/VisualLoggerDebugSnapshotInterface.h"
+
+FGameplayDebuggerCategory_SLP::FGameplayDebuggerCategory_SLP()
+{
+	bShowOnlyWithDebugActor = false;
+}
+
+TSharedRef<FGameplayDebuggerCategory> FGameplayDebuggerCategory_SLP::MakeInstance()
+{
+	return MakeShareable(new FGameplayDebuggerCategory_SLP());
+}
+
+void FGameplayDebuggerCategory_SLP::CollectData(APlayerController* OwnerPC, AActor* DebugActor)
+{
+	if(DebugActor) AddActorSnapshot(DebugActor);
+
+	// elevators and ladders can't be picked as the debug actor, show the ones around the viewer instead
+	const APawn* Viewer = OwnerPC ? OwnerPC -> GetPawn() : nullptr;
+	if(!Viewer) return;
+
+	const float RangeSquared = FMath::Square(NearbyRange);
+	for(TActorIterator<AElevator> It(OwnerPC -> GetWorld()); It; ++It)
+	{
+		if(FVector::DistSquared(It -> GetActorLocation(), Viewer -> GetActorLocation()) < RangeSquared) AddActorSnapshot(*It);
+	}
+	for(TActorIterator<ALadder> It(OwnerPC -> GetWorld()); It; ++It)
+	{
+		if(FVector::DistSquared(It -> GetActorLocation(), Viewer -> GetActorLocation()) < RangeSquared) AddActorSnapshot(*It);
+	}
+}
+
+void FGameplayDebuggerCategory_SLP::AddActorSnapshot(const AActor* Actor)
+{
+#if ENABLE_VISUAL_LOG
+	const IVisualLoggerDebugSnapshotInterface* Snapshotter = Cast<const IVisualLoggerDebugSnapshotInterface>(Actor);
+	if(!Snapshotter) return;
+
+	FVisualLogEntry Entry;
+	Snapshotter -> GrabDebugSnapshot(&Entry);
+
+	for(const FVisualLogStatusCategory& Category : Entry.Status)
+	{
+		AddTextLine(FString::Printf(TEXT("{yellow}%s {white}%s"), *Category.Category, *Actor -> GetName()));
+		for(int32 Index = 0; Index < Category.Data.Num(); ++Index)
+		{
+			FString Key, Value;
+			if(Category.GetDesc(Index, Key, Value)) AddTextLine(FString::Printf(TEXT("  {grey}%s: {white}%s"), *Key, *Value));
+		}
+	}
+
+	for(const FVisualLogShapeElement& Element : Entry.ElementsToDraw)
+	{
+		switch (Element.Type)
+		{
+			case EVisualLoggerShapeElement::Segment:
+				if(Element.Points.Num() >= 2) AddShape(FGameplayDebuggerShape::MakeSegment(Element.Points[0], Element.Points[1], 2.f, Element.GetFColor(), Element.Description));
+				break;
+			case EVisualLoggerShapeElement::SinglePoint:
+				if(Element.Points.Num() >= 1) AddShape(FGameplayDebuggerShape::MakePoint(Element.Points[0], 10.f, Element.GetFColor(), Element.Description));
+				break;
+			default:
+				break;
+		}
+	}
+#endif
+}
+
+#endif // WITH_GAMEPLAY_DEBUGGER
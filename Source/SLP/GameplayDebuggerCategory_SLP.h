@@ -0,0 +1,32 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#if WITH_GAMEPLAY_DEBUGGER
+#include "GameplayDebuggerCategory.h"
+
+class AActor;
+class APlayerController;
+
+/**
+ * Gameplay debugger category for SLP, shows the visual logger snapshot of the debug actor and of the elevators and ladders around the viewer
+ */
+class FGameplayDebuggerCategory_SLP : public FGameplayDebuggerCategory
+{
+public:
+	FGameplayDebuggerCategory_SLP();
+
+	virtual void CollectData(APlayerController* OwnerPC, AActor* DebugActor) override;
+
+	static TSharedRef<FGameplayDebuggerCategory> MakeInstance();
+
+private:
+	// the snapshot is the single description of an actor's debug state, it is turned into text lines and shapes here
+	void AddActorSnapshot(const AActor* Actor);
+
+	float NearbyRange = 3000.f;
+};
+
+#endif // WITH_GAMEPLAY_DEBUGGER
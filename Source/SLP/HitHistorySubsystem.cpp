@@ -0,0 +1,128 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "HitHistorySubsystem.h"
+
+#include "SLP.h"
+#include "BaseCharacter.h"
+#include "TransformHistory.h"
+#include "Components/CapsuleComponent.h"
+#include "Engine/World.h"
+#include "GameFramework/GameStateBase.h"
+
+DECLARE_CYCLE_STAT(TEXT("Hit History Record"), STAT_HitHistoryRecord, STATGROUP_SLP);
+DECLARE_CYCLE_STAT(TEXT("Hit History Rewind"), STAT_HitHistoryRewind, STATGROUP_SLP);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Hit History Characters"), STAT_HitHistoryCharacters, STATGROUP_SLP);
+
+static TAutoConsoleVariable<float> CVarHitHistorySampleInterval(
+	TEXT("slp.HitHistory.SampleInterval"), 1.f / 60.f,
+	TEXT("Minimum seconds between recorded poses, the history holds 64 of them."));
+
+static TAutoConsoleVariable<float> CVarHitHistoryMaxRewind(
+	TEXT("slp.HitHistory.MaxRewind"), 0.5f,
+	TEXT("Furthest back in seconds a hit is rewound, older claims are checked at this age."));
+
+void FHitHistoryTickFunction::ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent)
+{
+	if(Subsystem) Subsystem -> RecordHistory();
+}
+
+FString FHitHistoryTickFunction::DiagnosticMessage()
+{
+	return TEXT("FHitHistoryTickFunction");
+}
+
+bool UHitHistorySubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game or WorldType == EWorldType::PIE;
+}
+
+void UHitHistorySubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	// after movement, including the server moves applied for remote players
+	RecordTickFunction.Subsystem = this;
+	RecordTickFunction.bCanEverTick = true;
+	RecordTickFunction.bStartWithTickEnabled = true;
+	RecordTickFunction.TickGroup = TG_PostUpdateWork;
+	RecordTickFunction.RegisterTickFunction(InWorld.PersistentLevel);
+}
+
+void UHitHistorySubsystem::Deinitialize()
+{
+	if(RecordTickFunction.IsTickFunctionRegistered()) RecordTickFunction.UnRegisterTickFunction();
+	RecordTickFunction.Subsystem = nullptr;
+
+	Super::Deinitialize();
+}
+
+void UHitHistorySubsystem::RegisterCharacter(ABaseCharacter* Character)
+{
+	LLM_SCOPE_BYTAG(SLP_Combat);
+
+	if(Character) Characters.AddUnique(Character);
+}
+
+void UHitHistorySubsystem::UnregisterCharacter(ABaseCharacter* Character)
+{
+	Characters.RemoveSwap(Character);
+}
+
+void UHitHistorySubsystem::RecordHistory()
+{
+	LLM_SCOPE_BYTAG(SLP_Combat);
+
+	SCOPE_CYCLE_COUNTER(STAT_HitHistoryRecord);
+
+	const double Now = GetServerWorldTime();
+	if(LastRecordTime >= 0.0 and Now - LastRecordTime < CVarHitHistorySampleInterval.GetValueOnGameThread()) return;
+	LastRecordTime = Now;
+
+	for(int32 i = Characters.Num() - 1; i >= 0; --i)
+	{
+		ABaseCharacter* Character = Characters[i].Get();
+		if(!Character)
+		{
+			Characters.RemoveAtSwap(i);
+			continue;
+		}
+		if(!Character -> IsPooled()) Character -> RecordTransformHistory(Now);
+	}
+
+	SET_DWORD_STAT(STAT_HitHistoryCharacters, Characters.Num());
+}
+
+bool UHitHistorySubsystem::ValidateHit(const ABaseCharacter* Victim, double HitServerTime, const FVector& HitLocation, float Tolerance) const
+{
+	SCOPE_CYCLE_COUNTER(STAT_HitHistoryRewind);
+	if(!Victim) return false;
+
+	// a client can't claim a hit from further back than the rewind window
+	const double Now = GetServerWorldTime();
+	const double Time = FMath::Clamp(HitServerTime, Now - CVarHitHistoryMaxRewind.GetValueOnGameThread(), Now);
+
+	FRewoundPose Pose;
+	if(!Victim -> GetTransformHistory().Rewind(Time, Pose)) return false;
+	if(Pose.bInvincible) return false;	// rolling when the client swung
+
+	// capsule as a segment with the capsule's radius
+	const UCapsuleComponent* Capsule = Victim -> GetCapsuleComponent();
+	const FVector Up = Pose.Capsule.GetUnitAxis(EAxis::Z) * Capsule -> GetScaledCapsuleHalfHeight_WithoutHemisphere();
+	const FVector Center = Pose.Capsule.GetLocation();
+	const float Reach = Capsule -> GetScaledCapsuleRadius() + Tolerance;
+	if(FMath::PointDistToSegmentSquared(HitLocation, Center - Up, Center + Up) <= FMath::Square(Reach)) return true;
+
+	for(int32 i = 0; i < Pose.NumHitboxes; ++i)
+	{
+		if(FVector::DistSquared(HitLocation, Pose.Hitboxes[i].GetLocation()) <= FMath::Square(Tolerance)) return true;
+	}
+	return false;
+}
+
+double UHitHistorySubsystem::GetServerWorldTime() const
+{
+	const UWorld* World = GetWorld();
+	const AGameStateBase* GameState = World -> GetGameState();
+	return GameState ? GameState -> GetServerWorldTimeSeconds() : World -> GetTimeSeconds();
+}
@@ -0,0 +1,63 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/EngineBaseTypes.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "HitHistorySubsystem.generated.h"
+
+class ABaseCharacter;
+
+USTRUCT()
+struct FHitHistoryTickFunction : public FTickFunction
+{
+	GENERATED_BODY()
+
+	class UHitHistorySubsystem* Subsystem = nullptr;
+
+	virtual void ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent) override;
+	virtual FString DiagnosticMessage() override;
+};
+
+template<>
+struct TStructOpsTypeTraits<FHitHistoryTickFunction> : public TStructOpsTypeTraitsBase2<FHitHistoryTickFunction>
+{
+	enum
+	{
+		WithCopy = false
+	};
+};
+
+/**
+ * Records the server's character poses at the end of every frame and checks client hits against where the victim was when the client swung
+ */
+UCLASS()
+class SLP_API UHitHistorySubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+
+	// server only, the characters add themselves at BeginPlay
+	void RegisterCharacter(ABaseCharacter* Character);
+	void UnregisterCharacter(ABaseCharacter* Character);
+
+	void RecordHistory();
+
+	// true when HitLocation touched Victim's rewound capsule or hitboxes at HitServerTime and it wasn't rolling then
+	bool ValidateHit(const ABaseCharacter* Victim, double HitServerTime, const FVector& HitLocation, float Tolerance) const;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	double GetServerWorldTime() const;
+
+	FHitHistoryTickFunction RecordTickFunction;
+
+	TArray<TWeakObjectPtr<ABaseCharacter>> Characters;
+	double LastRecordTime = -1.0;
+};
@@ -5,11 +5,19 @@
 
 #include "Components/BoxComponent.h"
 #include "BaseCharacter.h"
+#include "SignificanceComponent.h"
+#include "FrameScratchArena.h"
 #include "GameFramework/CharacterMovementComponent.h"
+#include "NavLinkCustomComponent.h"
+#include "Navigation/PathFollowingComponent.h"
+#include "BaseAIController.h"
+#include "SLP.h"
 
 // Sets default values
 ALadder::ALadder()
 {
+	LLM_SCOPE_BYTAG(SLP_Traversal);
+
  	// Set this actor to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
 	PrimaryActorTick.bCanEverTick = true;
 
@@ -27,39 +35,122 @@ ALadder::ALadder()
 
 	LadderDownEndCollision = CreateDefaultSubobject<UBoxComponent>(TEXT("LadderDownEndCollision"));
 	LadderDownEndCollision -> SetupAttachment(LadderDownCollision);
+
+	NavLink = CreateDefaultSubobject<UNavLinkCustomComponent>(TEXT("NavLink"));
+	Significance = CreateDefaultSubobject<USignificanceComponent>(TEXT("Significance"));
+
+	// ladders never change at runtime, if one is made to replicate it stays dormant in the replication graph
+	NetDormancy = DORM_Initial;
 }
 
 // Called when the game starts or when spawned
 void ALadder::BeginPlay()
 {
+	LLM_SCOPE_BYTAG(SLP_Traversal);
+
 	Super::BeginPlay();
 	
 	LadderHeight = LadderUpCollision -> GetComponentLocation().Z - LadderDownCollision -> GetComponentLocation().Z;
-	UE_LOG(LogTemp, Warning, TEXT("Ladder Height: %f"), LadderHeight);
+	UE_VLOG(this, LogSLP, Log, TEXT("Ladder height: %f"), LadderHeight);
+
+	NavLink -> SetMoveReachedLink(this, &ALadder::OnNavLinkReached);
 }
 
 // Called every frame
 void ALadder::Tick(float DeltaTime)
 {
+	LLM_SCOPE_BYTAG(SLP_Traversal);
+
 	Super::Tick(DeltaTime);
 	
-	if(PlayerActor)	CheckEnds();
+	if(PlayerActor)
+	{
+		UE_VLOG(this, LogSLP, VeryVerbose, TEXT("Occupied by %s"), *PlayerActor -> GetName());	// keeps a snapshot per frame while climbed
+		CheckEnds();
+	}
 	else PlayerActor = DetectPlayer();
 }
 
+void ALadder::OnConstruction(const FTransform& Transform)
+{
+	Super::OnConstruction(Transform);
+
+	// walkers enter and leave where the player does, both ways
+	NavLink -> SetLinkData(
+		Transform.InverseTransformPosition(LadderDownCollision -> GetComponentLocation()),
+		Transform.InverseTransformPosition(LadderUpCollision -> GetComponentLocation()),
+		ENavLinkDirection::BothWays);
+}
+
+void ALadder::OnNavLinkReached(UNavLinkCustomComponent* Link, UObject* PathingAgent, const FVector& DestPoint)
+{
+	UPathFollowingComponent* PathFollowing = Cast<UPathFollowingComponent>(PathingAgent);
+	ABaseAIController* Controller = PathFollowing ? Cast<ABaseAIController>(PathFollowing -> GetOwner()) : nullptr;
+	if(!Controller)
+	{
+		if(PathFollowing) PathFollowing -> FinishUsingCustomLink(Link);	// nothing to drive the climb, don't leave the move paused
+		return;
+	}
+	Controller -> BeginNavLinkTraversal(this, Link, DestPoint);
+}
+
+void ALadder::BeginClimb(ABaseCharacter* Character, bool bUp)
+{
+	// same snap the player gets when grabbing the ladder
+	Character -> SetCurrentState(PlayerCurrentState::Ladder);
+	Character -> GetCharacterMovement() -> Velocity = FVector::ZeroVector;
+	Character -> SetActorLocation(bUp ? LadderDownEndCollision -> GetComponentLocation() + FVector(0, 0, 130) : LadderUpEndCollision -> GetComponentLocation() + FVector(0, 0, -130));
+	const FRotator NewRotation = (LadderMesh -> GetComponentLocation() - Character -> GetActorLocation()).Rotation();
+	Character -> SetActorRotation(FRotator(0, NewRotation.Yaw, 0));
+}
+
+bool ALadder::HasReachedEnd(const ABaseCharacter* Character, bool bUp) const
+{
+	return (bUp ? LadderUpEndCollision : LadderDownEndCollision) -> IsOverlappingActor(Character);
+}
+
+void ALadder::EndClimb(ABaseCharacter* Character, bool bUp)
+{
+	Character -> SetCurrentState(PlayerCurrentState::Idle);	// leaving the ladder state restores walking
+	Character -> SetActorLocation((bUp ? LadderUpCollision : LadderDownCollision) -> GetComponentLocation());
+}
+
+#if ENABLE_VISUAL_LOG
+void ALadder::GrabDebugSnapshot(FVisualLogEntry* Snapshot) const
+{
+	FVisualLogStatusCategory Category(TEXT("SLP Ladder"));
+	Category.Add(TEXT("Occupant"), PlayerActor ? PlayerActor -> GetName() : TEXT("none"));
+	Category.Add(TEXT("Height"), FString::Printf(TEXT("%.0f"), LadderHeight));
+	Snapshot -> Status.Add(Category);
+
+	const FVector Bottom = LadderDownEndCollision -> GetComponentLocation();
+	const FVector Top = LadderUpEndCollision -> GetComponentLocation();
+	Snapshot -> AddSegment(Bottom, Top, LogSLP.GetCategoryName(), ELogVerbosity::Log, PlayerActor ? FColor::Green : FColor::White, TEXT("ladder"));
+	Snapshot -> AddLocation(Bottom, LogSLP.GetCategoryName(), ELogVerbosity::Log, FColor::Blue, TEXT("bottom end"), 15);
+	Snapshot -> AddLocation(Top, LogSLP.GetCategoryName(), ELogVerbosity::Log, FColor::Blue, TEXT("top end"), 15);
+}
+#endif
+
+void ALadder::SerializeSnapshot(FArchive& Ar)
+{
+	UObject* Occupant = PlayerActor;	// saved as a path, resolved back to the live character on load
+	Ar << Occupant;
+	if(Ar.IsLoading()) PlayerActor = Cast<AActor>(Occupant);
+}
+
 AActor* ALadder::DetectPlayer()
 {
-	TArray<AActor*> OverlappingActorsDown;
-	TArray<AActor*> OverlappingActorsUp;
-	LadderDownCollision -> GetOverlappingActors(OverlappingActorsDown, ABaseCharacter::StaticClass());
-	LadderUpCollision -> GetOverlappingActors(OverlappingActorsUp, ABaseCharacter::StaticClass());
+	TArray<AActor*, FFrameScratchAllocator> OverlappingActorsDown;
+	TArray<AActor*, FFrameScratchAllocator> OverlappingActorsUp;
+	GetOverlappingActorsOfClass(LadderDownCollision, OverlappingActorsDown, ABaseCharacter::StaticClass());
+	GetOverlappingActorsOfClass(LadderUpCollision, OverlappingActorsUp, ABaseCharacter::StaticClass());
 	if(OverlappingActorsDown.Num() > 0)
 	{
 		for(AActor* Actor : OverlappingActorsDown)
 		{
 			if(Actor -> ActorHasTag("Player"))
 			{
-				UE_LOG(LogTemp, Warning, TEXT("(Down) Player in range!"));
+				UE_VLOG(this, LogSLP, Verbose, TEXT("Player in range of the bottom"));
 				ABaseCharacter* PlayerChar = Cast<ABaseCharacter>(Actor);
 				if(PlayerChar -> GetCurrentState() == PlayerCurrentState::Ladder) 
 				{
@@ -81,7 +172,7 @@ AActor* ALadder::DetectPlayer()
 		{
 			if(Actor -> ActorHasTag("Player"))
 			{
-				UE_LOG(LogTemp, Warning, TEXT("(Up) Player in range!"));
+				UE_VLOG(this, LogSLP, Verbose, TEXT("Player in range of the top"));
 				ABaseCharacter* PlayerChar = Cast<ABaseCharacter>(Actor);
 				if(PlayerChar -> GetCurrentState() == PlayerCurrentState::Ladder) 
 				{
@@ -102,25 +193,22 @@ AActor* ALadder::DetectPlayer()
 
 void ALadder::CheckEnds()
 {
-	TArray<AActor*> OverlappingActorsDownEnd;
-	TArray<AActor*> OverlappingActorsUpEnd;
-	LadderDownEndCollision -> GetOverlappingActors(OverlappingActorsDownEnd, ABaseCharacter::StaticClass());
-	LadderUpEndCollision -> GetOverlappingActors(OverlappingActorsUpEnd, ABaseCharacter::StaticClass());
+	TArray<AActor*, FFrameScratchAllocator> OverlappingActorsDownEnd;
+	TArray<AActor*, FFrameScratchAllocator> OverlappingActorsUpEnd;
+	GetOverlappingActorsOfClass(LadderDownEndCollision, OverlappingActorsDownEnd, ABaseCharacter::StaticClass());
+	GetOverlappingActorsOfClass(LadderUpEndCollision, OverlappingActorsUpEnd, ABaseCharacter::StaticClass());
 	if(OverlappingActorsDownEnd.Num() > 0)
 	{
 		for(AActor* Actor : OverlappingActorsDownEnd)
 		{
 			if(Actor -> ActorHasTag("Player"))
 			{
-				UE_LOG(LogTemp, Warning, TEXT("(DownEnd) Player in range!"));
 				ABaseCharacter* PlayerChar = Cast<ABaseCharacter>(Actor);
 				if(PlayerChar -> GetCurrentState() == PlayerCurrentState::Ladder) 
 				{
-					UE_LOG(LogTemp, Warning, TEXT("Teleporting player to the bottom of the ladder"));
-					PlayerChar -> GetCharacterMovement() -> SetMovementMode(EMovementMode::MOVE_Walking);
-					PlayerChar -> SetCurrentState(PlayerCurrentState::Default);
+					UE_VLOG(this, LogSLP, Log, TEXT("Player left at the bottom"));
+					PlayerChar -> SetCurrentState(PlayerCurrentState::Idle);	// leaving the ladder state restores walking
 					PlayerChar -> SetActorLocation(LadderDownCollision -> GetComponentLocation());
-					PlayerChar -> SetCanRoll();
 					PlayerActor = nullptr;
 				} 
 			} 
@@ -132,15 +220,12 @@ void ALadder::CheckEnds()
 		{
 			if(Actor -> ActorHasTag("Player"))
 			{
-				UE_LOG(LogTemp, Warning, TEXT("(UpEnd) Player in range!"));
 				ABaseCharacter* PlayerChar = Cast<ABaseCharacter>(Actor);
 				if(PlayerChar -> GetCurrentState() == PlayerCurrentState::Ladder) 
 				{
-					UE_LOG(LogTemp, Warning, TEXT("Teleporting player to the bottom of the ladder"));
-					PlayerChar -> GetCharacterMovement() -> SetMovementMode(EMovementMode::MOVE_Walking);
-					PlayerChar -> SetCurrentState(PlayerCurrentState::Default);
+					UE_VLOG(this, LogSLP, Log, TEXT("Player left at the top"));
+					PlayerChar -> SetCurrentState(PlayerCurrentState::Idle);	// leaving the ladder state restores walking
 					PlayerChar -> SetActorLocation(LadderUpCollision -> GetComponentLocation());
-					PlayerChar -> SetCanRoll();
 					PlayerActor = nullptr;
 				} 
 			} 
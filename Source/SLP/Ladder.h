@@ -4,10 +4,11 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
+#include "VisualLogger/VisualLoggerDebugSnapshotInterface.h"
 #include "Ladder.generated.h"
 
 UCLASS()
-class SLP_API ALadder : public AActor
+class SLP_API ALadder : public AActor, public IVisualLoggerDebugSnapshotInterface
 {
 	GENERATED_BODY()
 	
@@ -22,6 +23,22 @@ protected:
 public:	
 	// Called every frame
 	virtual void Tick(float DeltaTime) override;
+
+	// keeps the nav link on the bottom and top volumes while the ladder is edited
+	virtual void OnConstruction(const FTransform& Transform) override;
+
+	// AI climbs, started when the path reaches the nav link and driven by the AI controller
+	void BeginClimb(class ABaseCharacter* Character, bool bUp);
+	bool HasReachedEnd(const class ABaseCharacter* Character, bool bUp) const;
+	void EndClimb(class ABaseCharacter* Character, bool bUp);
+
+	// writes or reads (Ar.IsLoading()) the state kept in world snapshots
+	void SerializeSnapshot(FArchive& Ar);
+
+#if ENABLE_VISUAL_LOG
+	// occupant and both ends, shown by the visual logger and the SLP gameplay debugger category
+	virtual void GrabDebugSnapshot(FVisualLogEntry* Snapshot) const override;
+#endif
 private:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Ladder", meta = (AllowPrivateAccess = "true"))
 	class UBoxComponent* LadderUpCollision;
@@ -38,6 +55,15 @@ private:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Ladder", meta = (AllowPrivateAccess = "true"))
 	class UStaticMeshComponent* LadderMesh;
 
+	// baked into the static navmesh between the bottom and top volumes, AI paths climb through it
+	UPROPERTY(VisibleAnywhere, Category = "Ladder", meta = (AllowPrivateAccess = "true"))
+	class UNavLinkCustomComponent* NavLink;
+
+	UPROPERTY(VisibleAnywhere, Category = "Ladder", meta = (AllowPrivateAccess = "true"))
+	class USignificanceComponent* Significance;
+
+	void OnNavLinkReached(class UNavLinkCustomComponent* Link, UObject* PathingAgent, const FVector& DestPoint);
+
 	float LadderHeight;
 	AActor* DetectPlayer();
 	void CheckEnds();
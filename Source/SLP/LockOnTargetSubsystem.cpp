@@ -0,0 +1,23 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "LockOnTargetSubsystem.h"
+
+#include "SLP.h"
+
+void ULockOnTargetSubsystem::RegisterTarget(AActor* Target)
+{
+	LLM_SCOPE_BYTAG(SLP_Combat);
+
+	if(Target) Targets.AddUnique(Target);
+}
+
+void ULockOnTargetSubsystem::UnregisterTarget(AActor* Target)
+{
+	Targets.RemoveSwap(Target);
+}
+
+const TArray<TWeakObjectPtr<AActor>>& ULockOnTargetSubsystem::GetTargets() const
+{
+	return Targets;
+}
@@ -0,0 +1,25 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "LockOnTargetSubsystem.generated.h"
+
+/**
+ * Registry of everything that can be locked on to, so locked on characters can pick up new targets without sweeping
+ */
+UCLASS()
+class SLP_API ULockOnTargetSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	void RegisterTarget(AActor* Target);
+	void UnregisterTarget(AActor* Target);
+
+	const TArray<TWeakObjectPtr<AActor>>& GetTargets() const;
+
+private:
+	TArray<TWeakObjectPtr<AActor>> Targets;
+};
@@ -0,0 +1,313 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PathRequestSubsystem.h"
+
+#include "SLP.h"
+#include "NavigationSystem.h"
+#include "NavMesh/NavMeshPath.h"
+#include "NavMesh/RecastNavMesh.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Path Queries"), STAT_PathQueries, STATGROUP_SLP);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Path Queue"), STAT_PathQueue, STATGROUP_SLP);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Path Shared Results"), STAT_PathSharedResults, STATGROUP_SLP);
+
+static TAutoConsoleVariable<int32> CVarPathMaxQueriesPerFrame(
+	TEXT("slp.Path.MaxQueriesPerFrame"), 4,
+	TEXT("Maximum number of async path queries started per frame, the rest wait in the queue."));
+
+static TAutoConsoleVariable<float> CVarPathStartRegionSize(
+	TEXT("slp.Path.StartRegionSize"), 1000.f,
+	TEXT("Requests for the same goal cell starting in the same region of this size share a query, each joins the shared path at its nearest point."));
+
+static TAutoConsoleVariable<float> CVarPathGoalCellSize(
+	TEXT("slp.Path.GoalCellSize"), 100.f,
+	TEXT("Requests ending in the same cell of this size share a query."));
+
+static TAutoConsoleVariable<float> CVarPathCacheTime(
+	TEXT("slp.Path.CacheTime"), 0.5f,
+	TEXT("Seconds a found path is handed out to new requests for the same start region and goal cell."));
+
+bool UPathRequestSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game or WorldType == EWorldType::PIE;
+}
+
+TStatId UPathRequestSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UPathRequestSubsystem, STATGROUP_Tickables);
+}
+
+UPathRequestSubsystem::FPathKey UPathRequestSubsystem::MakeKey(const FVector& Start, const FVector& Goal) const
+{
+	const float StartCell = FMath::Max(CVarPathStartRegionSize.GetValueOnGameThread(), 1.f);
+	const float GoalCell = FMath::Max(CVarPathGoalCellSize.GetValueOnGameThread(), 1.f);
+	return FPathKey(
+		FIntVector(FMath::FloorToInt(Start.X / StartCell), FMath::FloorToInt(Start.Y / StartCell), FMath::FloorToInt(Start.Z / StartCell)),
+		FIntVector(FMath::FloorToInt(Goal.X / GoalCell), FMath::FloorToInt(Goal.Y / GoalCell), FMath::FloorToInt(Goal.Z / GoalCell)));
+}
+
+void UPathRequestSubsystem::RequestPath(const FVector& Start, const FVector& Goal, FBatchedPathDelegate OnComplete)
+{
+	LLM_SCOPE_BYTAG(SLP_AI);
+
+	const FPathKey Key = MakeKey(Start, Goal);
+
+	if(const FCachedPath* Cached = Cache.Find(Key))
+	{
+		if(Cached -> ExpireTime > GetWorld() -> GetTimeSeconds())
+		{
+			INC_DWORD_STAT(STAT_PathSharedResults);
+			FPathWaiter Waiter{ Start, MoveTemp(OnComplete) };
+			AnswerWaiter(Waiter, Goal, *Cached -> Path);
+			return;
+		}
+	}
+
+	FPathGroup* Group = Groups.Find(Key);
+	if(!Group)
+	{
+		Group = &Groups.Add(Key);
+		Group -> Start = Start;
+		Group -> Goal = Goal;
+		Queue.Add(Key);
+	}
+	else
+	{
+		INC_DWORD_STAT(STAT_PathSharedResults);
+	}
+	Group -> Waiters.Add({ Start, MoveTemp(OnComplete) });
+}
+
+void UPathRequestSubsystem::Tick(float DeltaTime)
+{
+	LLM_SCOPE_BYTAG(SLP_AI);
+
+	Super::Tick(DeltaTime);
+
+	DispatchQueries();
+
+	// forget old results now and then, the cache is only there for bursts of requests
+	TimeSincePurge += DeltaTime;
+	if(TimeSincePurge >= 1.f)
+	{
+		TimeSincePurge = 0.f;
+		const double Now = GetWorld() -> GetTimeSeconds();
+		for(auto It = Cache.CreateIterator(); It; ++It)
+		{
+			if(It -> Value.ExpireTime <= Now) It.RemoveCurrent();
+		}
+	}
+
+	SET_DWORD_STAT(STAT_PathQueue, Queue.Num());
+}
+
+void UPathRequestSubsystem::DispatchQueries()
+{
+	UNavigationSystemV1* NavSys = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld());
+	ANavigationData* NavData = NavSys ? NavSys -> GetDefaultNavDataInstance() : nullptr;
+	if(!NavData)
+	{
+		// nothing to path on, answer everyone queued so nobody waits for a query that never starts
+		for(const FPathKey& Key : Queue)
+		{
+			FPathGroup Group;
+			if(Groups.RemoveAndCopyValue(Key, Group)) FailWaiters(Group);
+		}
+		Queue.Reset();
+		for(FDedicatedQuery& Dedicated : DedicatedQueue)
+		{
+			Dedicated.OnComplete.ExecuteIfBound(nullptr);
+		}
+		DedicatedQueue.Reset();
+		return;
+	}
+
+	const int32 MaxQueries = CVarPathMaxQueriesPerFrame.GetValueOnGameThread();
+	int32 Dispatched = 0;
+	int32 Consumed = 0;
+
+	// dedicated queries already waited for a shared one, they go first
+	for(; Consumed < DedicatedQueue.Num() and Dispatched < MaxQueries; ++Consumed)
+	{
+		FDedicatedQuery& Dedicated = DedicatedQueue[Consumed];
+		FPathFindingQuery Query(this, *NavData, Dedicated.Start, Dedicated.Goal);
+		const uint32 QueryId = NavSys -> FindPathAsync(
+			FNavAgentProperties::DefaultProperties,
+			Query,
+			FNavPathQueryDelegate::CreateUObject(this, &UPathRequestSubsystem::OnPathFound),
+			EPathFindingMode::Regular);
+
+		DedicatedInFlight.Add(QueryId, MoveTemp(Dedicated.OnComplete));
+		++Dispatched;
+	}
+	DedicatedQueue.RemoveAt(0, Consumed, EAllowShrinking::No);
+	Consumed = 0;
+
+	for(; Consumed < Queue.Num() and Dispatched < MaxQueries; ++Consumed)
+	{
+		const FPathKey& Key = Queue[Consumed];
+		FPathGroup* Group = Groups.Find(Key);
+		if(!Group or Group -> bInFlight) continue;
+
+		FPathFindingQuery Query(this, *NavData, Group -> Start, Group -> Goal);
+		const uint32 QueryId = NavSys -> FindPathAsync(
+			FNavAgentProperties::DefaultProperties,
+			Query,
+			FNavPathQueryDelegate::CreateUObject(this, &UPathRequestSubsystem::OnPathFound),
+			EPathFindingMode::Regular);
+
+		Group -> bInFlight = true;
+		InFlight.Add(QueryId, Key);
+		++Dispatched;
+	}
+	Queue.RemoveAt(0, Consumed, EAllowShrinking::No);
+
+	SET_DWORD_STAT(STAT_PathQueries, Dispatched);
+}
+
+void UPathRequestSubsystem::OnPathFound(uint32 QueryId, ENavigationQueryResult::Type Result, FNavPathSharedPtr Path)
+{
+	LLM_SCOPE_BYTAG(SLP_AI);
+
+	const bool bSuccess = Result == ENavigationQueryResult::Success and Path.IsValid() and Path -> IsValid();
+
+	FBatchedPathDelegate OnComplete;
+	if(DedicatedInFlight.RemoveAndCopyValue(QueryId, OnComplete))
+	{
+		OnComplete.ExecuteIfBound(bSuccess ? Path : nullptr);
+		return;
+	}
+
+	FPathKey Key;
+	if(!InFlight.RemoveAndCopyValue(QueryId, Key)) return;
+
+	FPathGroup Group;
+	if(!Groups.RemoveAndCopyValue(Key, Group)) return;
+
+	if(!bSuccess)
+	{
+		FailWaiters(Group);
+		return;
+	}
+
+	FCachedPath& Cached = Cache.Add(Key);
+	Cached.Path = Path;
+	Cached.ExpireTime = GetWorld() -> GetTimeSeconds() + CVarPathCacheTime.GetValueOnGameThread();
+
+	// every waiter gets its own copy starting where it stands, path following keeps per-path state
+	for(FPathWaiter& Waiter : Group.Waiters)
+	{
+		AnswerWaiter(Waiter, Group.Goal, *Path);
+	}
+}
+
+void UPathRequestSubsystem::AnswerWaiter(FPathWaiter& Waiter, const FVector& Goal, const FNavigationPath& Source)
+{
+	if(FNavPathSharedPtr Path = MakePathFor(Waiter.Start, Source))
+	{
+		Waiter.OnComplete.ExecuteIfBound(Path);
+		return;
+	}
+
+	// no straight line onto the shared path, e.g. the other side of a wall in the same region
+	DedicatedQueue.Add({ Waiter.Start, Goal, MoveTemp(Waiter.OnComplete) });
+}
+
+void UPathRequestSubsystem::FailWaiters(FPathGroup& Group)
+{
+	for(FPathWaiter& Waiter : Group.Waiters)
+	{
+		Waiter.OnComplete.ExecuteIfBound(nullptr);
+	}
+}
+
+FNavPathSharedPtr UPathRequestSubsystem::MakePathFor(const FVector& Start, const FNavigationPath& Source)
+{
+	const TArray<FNavPathPoint>& SourcePoints = Source.GetPathPoints();
+	if(SourcePoints.IsEmpty()) return nullptr;
+
+	// join the shared path at the point nearest this waiter, the goal is always kept
+	int32 Nearest = 0;
+	FVector::FReal NearestDistance = TNumericLimits<FVector::FReal>::Max();
+	for(int32 i = 0; i < SourcePoints.Num() - 1; ++i)
+	{
+		const FVector::FReal Distance = FVector::DistSquared(Start, SourcePoints[i].Location);
+		if(Distance < NearestDistance)
+		{
+			NearestDistance = Distance;
+			Nearest = i;
+		}
+	}
+	const FNavPathPoint& Join = SourcePoints[Nearest];
+
+	// the waiter has to reach the join point in a straight line over the navmesh, the raycast gives the polys it crosses
+	const ANavigationData* NavData = Source.GetNavigationDataUsed();
+	if(!NavData) return nullptr;
+
+	FVector HitLocation;
+	FRaycastResult Raycast;
+	const FNavMeshPath* SourceNavMeshPath = Source.CastPath<FNavMeshPath>();
+	if(SourceNavMeshPath and NavData -> IsA<ARecastNavMesh>())
+	{
+		ARecastNavMesh::NavMeshRaycast(NavData, Start, Join.Location, HitLocation, Source.GetFilter(), Source.GetQuerier(), Raycast);
+		if(Raycast.HasHit() or Raycast.CorridorPolysCount == 0 or Raycast.CorridorPolys[Raycast.CorridorPolysCount - 1] != Join.NodeRef) return nullptr;
+	}
+	else if(NavData -> Raycast(Start, Join.Location, HitLocation, Source.GetFilter(), Source.GetQuerier()))
+	{
+		return nullptr;
+	}
+
+	// navmesh paths keep their corridor, crowd following steers along it
+	FNavPathSharedPtr Path;
+	if(SourceNavMeshPath)
+	{
+		Path = MakeShared<FNavMeshPath, ESPMode::ThreadSafe>(*SourceNavMeshPath);
+	}
+	else
+	{
+		Path = MakeShared<FNavigationPath, ESPMode::ThreadSafe>(Source);
+	}
+
+	TArray<FNavPathPoint>& Points = Path -> GetPathPoints();
+	FNavPathPoint StartPoint = Join;
+	StartPoint.Location = Start;
+	if(Raycast.CorridorPolysCount > 0) StartPoint.NodeRef = Raycast.CorridorPolys[0];
+	if(Nearest == 0 and Start.Equals(Join.Location))
+	{
+		Points[0] = StartPoint;
+	}
+	else
+	{
+		Points.RemoveAt(0, Nearest);
+		Points.Insert(StartPoint, 0);
+	}
+
+	// the corridor runs from the waiter's poly through the raycast polys into the shared one at the join point
+	if(FNavMeshPath* NavMeshPath = Path -> CastPath<FNavMeshPath>())
+	{
+		const int32 CorridorStart = NavMeshPath -> PathCorridor.Find(Join.NodeRef);
+		if(CorridorStart > 0)
+		{
+			NavMeshPath -> PathCorridor.RemoveAt(0, CorridorStart);
+			if(NavMeshPath -> PathCorridorCost.Num() > CorridorStart) NavMeshPath -> PathCorridorCost.RemoveAt(0, CorridorStart);
+		}
+
+		const bool bHasCosts = NavMeshPath -> PathCorridorCost.Num() == NavMeshPath -> PathCorridor.Num();
+		const int32 Prepend = Raycast.CorridorPolysCount - 1;	// the last one is the join poly, already there
+		if(Prepend > 0)
+		{
+			NavMeshPath -> PathCorridor.Insert(Raycast.CorridorPolys, Prepend, 0);
+			if(bHasCosts)
+			{
+				for(int32 i = Prepend - 1; i >= 0; --i)
+				{
+					NavMeshPath -> PathCorridorCost.Insert(Raycast.CorridorCost[i], 0);
+				}
+			}
+		}
+	}
+	return Path;
+}
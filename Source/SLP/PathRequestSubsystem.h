@@ -0,0 +1,78 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "NavigationData.h"
+#include "PathRequestSubsystem.generated.h"
+
+// the path is null when no path was found
+DECLARE_DELEGATE_OneParam(FBatchedPathDelegate, FNavPathSharedPtr /* Path */);
+
+/**
+ * Shared queue for AI path queries, runs them async under a per-frame budget and shares results between near-identical requests
+ */
+UCLASS()
+class SLP_API UPathRequestSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	// the delegate is called on the game thread, right away when a recent result for the same start region and goal area is cached
+	void RequestPath(const FVector& Start, const FVector& Goal, FBatchedPathDelegate OnComplete);
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	using FPathKey = TPair<FIntVector, FIntVector>;
+
+	struct FPathWaiter
+	{
+		FVector Start;
+		FBatchedPathDelegate OnComplete;
+	};
+
+	// everyone heading for the same goal cell from the same start region waits on one query
+	struct FPathGroup
+	{
+		FVector Start;
+		FVector Goal;
+		TArray<FPathWaiter> Waiters;
+		bool bInFlight = false;
+	};
+
+	// a waiter that can't reach the shared path gets a query of its own
+	struct FDedicatedQuery
+	{
+		FVector Start;
+		FVector Goal;
+		FBatchedPathDelegate OnComplete;
+	};
+
+	struct FCachedPath
+	{
+		FNavPathSharedPtr Path;
+		double ExpireTime = 0.0;
+	};
+
+	FPathKey MakeKey(const FVector& Start, const FVector& Goal) const;
+	void DispatchQueries();
+	static void FailWaiters(FPathGroup& Group);
+	void OnPathFound(uint32 QueryId, ENavigationQueryResult::Type Result, FNavPathSharedPtr Path);
+	void AnswerWaiter(FPathWaiter& Waiter, const FVector& Goal, const FNavigationPath& Source);
+	// null when the shared path can't be joined in a straight line from Start
+	static FNavPathSharedPtr MakePathFor(const FVector& Start, const FNavigationPath& Source);
+
+	TMap<FPathKey, FPathGroup> Groups;
+	TArray<FPathKey> Queue;
+	TMap<uint32, FPathKey> InFlight;
+	TArray<FDedicatedQuery> DedicatedQueue;
+	TMap<uint32, FBatchedPathDelegate> DedicatedInFlight;
+	TMap<FPathKey, FCachedPath> Cache;
+	float TimeSincePurge = 0.f;
+};
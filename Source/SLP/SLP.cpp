@@ -2,5 +2,110 @@
 
 #include "SLP.h"
 #include "Modules/ModuleManager.h"
+#include "UObject/UObjectIterator.h"
+#include "Serialization/ArchiveCountMem.h"
+#include "GameFramework/Actor.h"
+#include "Components/ActorComponent.h"
+#include "Engine/World.h"
 
-IMPLEMENT_PRIMARY_GAME_MODULE( FDefaultGameModuleImpl, SLP, "SLP" );
+#if WITH_GAMEPLAY_DEBUGGER
+#include "GameplayDebugger.h"
+#include "GameplayDebuggerCategory_SLP.h"
+#endif
+
+DEFINE_LOG_CATEGORY(LogSLP);
+
+LLM_DEFINE_TAG(SLP);
+LLM_DEFINE_TAG(SLP_Characters, "Characters", "SLP");
+LLM_DEFINE_TAG(SLP_Traversal, "Traversal", "SLP");
+LLM_DEFINE_TAG(SLP_Combat, "Combat", "SLP");
+LLM_DEFINE_TAG(SLP_AI, "AI", "SLP");
+
+// instances, components and memory of every live object whose native class is in this module, blueprint subclasses listed on their own
+static void DumpMemory(const TArray<FString>& Args, UWorld* World, FOutputDevice& Ar)
+{
+	struct FClassMemory
+	{
+		int32 Instances = 0;
+		int32 Components = 0;
+		SIZE_T ObjectBytes = 0;
+		SIZE_T ComponentBytes = 0;
+	};
+
+	const UPackage* ScriptPackage = FindPackage(nullptr, TEXT("/Script/SLP"));
+	const bool bAllWorlds = Args.Contains(TEXT("all"));
+
+	TMap<const UClass*, FClassMemory> Classes;
+	for(TObjectIterator<UObject> It; It; ++It)
+	{
+		UObject* Object = *It;
+		if(!bAllWorlds and Object -> GetTypedOuter<UWorld>() != World) continue;
+
+		const UClass* NativeClass = Object -> GetClass();
+		while(NativeClass and !NativeClass -> HasAnyClassFlags(CLASS_Native)) NativeClass = NativeClass -> GetSuperClass();
+		if(!NativeClass or NativeClass -> GetOutermost() != ScriptPackage) continue;
+
+		// allocated size of the object and what its properties own, same as "obj list"
+		FClassMemory& Entry = Classes.FindOrAdd(Object -> GetClass());
+		++Entry.Instances;
+		Entry.ObjectBytes += FArchiveCountMem(Object).GetMax() + Object -> GetResourceSizeBytes(EResourceSizeMode::Exclusive);
+
+		if(const AActor* Actor = Cast<AActor>(Object))
+		{
+			for(UActorComponent* Component : Actor -> GetComponents())
+			{
+				if(!Component) continue;
+				++Entry.Components;
+				Entry.ComponentBytes += FArchiveCountMem(Component).GetMax() + Component -> GetResourceSizeBytes(EResourceSizeMode::Exclusive);
+			}
+		}
+	}
+
+	Classes.ValueSort([](const FClassMemory& A, const FClassMemory& B) { return A.ObjectBytes + A.ComponentBytes > B.ObjectBytes + B.ComponentBytes; });
+
+	FClassMemory Total;
+	Ar.Logf(TEXT("%-40s %9s %10s %12s %12s"), TEXT("Class"), TEXT("Count"), TEXT("Components"), TEXT("Object KB"), TEXT("Comp KB"));
+	for(const TPair<const UClass*, FClassMemory>& Pair : Classes)
+	{
+		const FClassMemory& Entry = Pair.Value;
+		Ar.Logf(TEXT("%-40s %9d %10d %12.1f %12.1f"), *Pair.Key -> GetName(), Entry.Instances, Entry.Components, Entry.ObjectBytes / 1024.f, Entry.ComponentBytes / 1024.f);
+
+		Total.Instances += Entry.Instances;
+		Total.Components += Entry.Components;
+		Total.ObjectBytes += Entry.ObjectBytes;
+		Total.ComponentBytes += Entry.ComponentBytes;
+	}
+	Ar.Logf(TEXT("%-40s %9d %10d %12.1f %12.1f"), TEXT("Total"), Total.Instances, Total.Components, Total.ObjectBytes / 1024.f, Total.ComponentBytes / 1024.f);
+}
+
+static FAutoConsoleCommandWithWorldArgsAndOutputDevice MemoryDumpCommand(
+	TEXT("slp.Memory.Dump"),
+	TEXT("Lists instance counts and object and component memory per SLP class in this world. Usage: slp.Memory.Dump [all]"),
+	FConsoleCommandWithWorldArgsAndOutputDeviceDelegate::CreateStatic(&DumpMemory));
+
+class FSLPModule : public FDefaultGameModuleImpl
+{
+public:
+	virtual void StartupModule() override
+	{
+#if WITH_GAMEPLAY_DEBUGGER
+		IGameplayDebugger& GameplayDebugger = IGameplayDebugger::Get();
+		GameplayDebugger.RegisterCategory("SLP", IGameplayDebugger::FOnGetCategory::CreateStatic(&FGameplayDebuggerCategory_SLP::MakeInstance), EGameplayDebuggerCategoryState::EnabledInGameAndSimulate);
+		GameplayDebugger.NotifyCategoriesChanged();
+#endif
+	}
+
+	virtual void ShutdownModule() override
+	{
+#if WITH_GAMEPLAY_DEBUGGER
+		if(IGameplayDebugger::IsAvailable())
+		{
+			IGameplayDebugger& GameplayDebugger = IGameplayDebugger::Get();
+			GameplayDebugger.UnregisterCategory("SLP");
+			GameplayDebugger.NotifyCategoriesChanged();
+		}
+#endif
+	}
+};
+
+IMPLEMENT_PRIMARY_GAME_MODULE( FSLPModule, SLP, "SLP" );
@@ -3,4 +3,18 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "Stats/Stats.h"
+#include "HAL/LowLevelMemTracker.h"
+#include "VisualLogger/VisualLogger.h"
 
+DECLARE_STATS_GROUP(TEXT("SLP"), STATGROUP_SLP, STATCAT_Advanced);
+
+// memory owned by the gameplay code, run with -llm and read it with "stat LLMFULL" or the csv, slp.Memory.Dump has the per-class view
+LLM_DECLARE_TAG_API(SLP, SLP_API);
+LLM_DECLARE_TAG_API(SLP_Characters, SLP_API);	// characters, their components, input and lock on arrays
+LLM_DECLARE_TAG_API(SLP_Traversal, SLP_API);	// elevators and ladders
+LLM_DECLARE_TAG_API(SLP_Combat, SLP_API);		// damage, hit history and lock on targets
+LLM_DECLARE_TAG_API(SLP_AI, SLP_API);			// AI controllers, pathing, crowd and visibility
+
+// gameplay events, recorded through the visual logger so nothing is formatted unless it is capturing
+DECLARE_LOG_CATEGORY_EXTERN(LogSLP, Log, All);
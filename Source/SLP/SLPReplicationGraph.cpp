@@ -0,0 +1,132 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SLPReplicationGraph.h"
+
+#include "SLP.h"
+#include "BaseCharacter.h"
+#include "Elevator.h"
+#include "Ladder.h"
+#include "Engine/LevelScriptActor.h"
+#include "GameFramework/Info.h"
+#include "GameFramework/PlayerController.h"
+#include "UObject/UObjectIterator.h"
+
+void USLPReplicationGraph::InitGlobalActorClassSettings()
+{
+	Super::InitGlobalActorClassSettings();
+
+	ClassRepNodePolicies.Set(AActor::StaticClass(), EClassRepNodeMapping::Spatialize_Dynamic);
+	ClassRepNodePolicies.Set(AInfo::StaticClass(), EClassRepNodeMapping::RelevantAllConnections);
+	ClassRepNodePolicies.Set(APlayerController::StaticClass(), EClassRepNodeMapping::NotRouted);
+	ClassRepNodePolicies.Set(ALevelScriptActor::StaticClass(), EClassRepNodeMapping::NotRouted);
+	ClassRepNodePolicies.Set(ABaseCharacter::StaticClass(), EClassRepNodeMapping::Spatialize_Dynamic);
+	ClassRepNodePolicies.Set(AElevator::StaticClass(), EClassRepNodeMapping::Spatialize_Dormancy);
+	ClassRepNodePolicies.Set(ALadder::StaticClass(), EClassRepNodeMapping::Spatialize_Dormancy);
+
+	// every replicated class starts from its own net settings
+	for(TObjectIterator<UClass> It; It; ++It)
+	{
+		UClass* Class = *It;
+		const AActor* ActorCDO = Cast<AActor>(Class -> GetDefaultObject());
+		if(!ActorCDO or !ActorCDO -> GetIsReplicated()) continue;
+		if(Class -> GetName().StartsWith(TEXT("SKEL_")) or Class -> GetName().StartsWith(TEXT("REINST_"))) continue;
+
+		FClassReplicationInfo ClassInfo;
+		ClassInfo.ReplicationPeriodFrame = GetReplicationPeriodFrameForFrequency(ActorCDO -> GetNetUpdateFrequency());
+		ClassInfo.SetCullDistanceSquared(ActorCDO -> GetNetCullDistanceSquared());
+
+		if(Class -> IsChildOf(AElevator::StaticClass()))
+		{
+			ClassInfo.SetCullDistanceSquared(FMath::Square(PlatformCullDistance));
+		}
+		GlobalActorReplicationInfoMap.SetClassInfo(Class, ClassInfo);
+	}
+}
+
+void USLPReplicationGraph::InitGlobalGraphNodes()
+{
+	LLM_SCOPE_BYTAG(SLP);
+
+	Super::InitGlobalGraphNodes();
+
+	GridNode = CreateNewNode<UReplicationGraphNode_GridSpatialization2D>();
+	GridNode -> CellSize = GridCellSize;
+	GridNode -> SpatialBias = SpatialBias;
+
+	// dynamic actors in each cell replicate less often the further and more off screen they are from the viewer
+	GridNode -> CreateCellNodeOverride = [](UReplicationGraphNode_GridSpatialization2D* Parent)
+	{
+		UReplicationGraphNode_GridCell* Cell = Parent -> CreateChildNode<UReplicationGraphNode_GridCell>();
+		Cell -> CreateDynamicNodeOverride = [](UReplicationGraphNode_GridCell* CellParent) -> UReplicationGraphNode*
+		{
+			return CellParent -> CreateChildNode<UReplicationGraphNode_DynamicSpatialFrequency>();
+		};
+		return Cell;
+	};
+	AddGlobalGraphNode(GridNode);
+
+	AlwaysRelevantNode = CreateNewNode<UReplicationGraphNode_ActorList>();
+	AddGlobalGraphNode(AlwaysRelevantNode);
+}
+
+void USLPReplicationGraph::InitConnectionGraphNodes(UNetReplicationGraphConnection* RepGraphConnection)
+{
+	LLM_SCOPE_BYTAG(SLP);
+
+	Super::InitConnectionGraphNodes(RepGraphConnection);
+
+	UReplicationGraphNode_AlwaysRelevant_ForConnection* ForConnectionNode = CreateNewNode<UReplicationGraphNode_AlwaysRelevant_ForConnection>();
+	AddConnectionGraphNode(ForConnectionNode, RepGraphConnection);
+}
+
+EClassRepNodeMapping USLPReplicationGraph::GetMappingPolicy(const AActor* Actor)
+{
+	if(Actor -> bAlwaysRelevant) return EClassRepNodeMapping::RelevantAllConnections;
+	if(Actor -> bOnlyRelevantToOwner) return EClassRepNodeMapping::NotRouted;
+
+	const EClassRepNodeMapping* Policy = ClassRepNodePolicies.Get(Actor -> GetClass());
+	return Policy ? *Policy : EClassRepNodeMapping::Spatialize_Dynamic;
+}
+
+void USLPReplicationGraph::RouteAddNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo, FGlobalActorReplicationInfo& GlobalInfo)
+{
+	switch(GetMappingPolicy(ActorInfo.Actor))
+	{
+	case EClassRepNodeMapping::RelevantAllConnections:
+		AlwaysRelevantNode -> NotifyAddNetworkActor(ActorInfo);
+		break;
+	case EClassRepNodeMapping::Spatialize_Static:
+		GridNode -> AddActor_Static(ActorInfo, GlobalInfo);
+		break;
+	case EClassRepNodeMapping::Spatialize_Dynamic:
+		GridNode -> AddActor_Dynamic(ActorInfo, GlobalInfo);
+		break;
+	case EClassRepNodeMapping::Spatialize_Dormancy:
+		GridNode -> AddActor_Dormancy(ActorInfo, GlobalInfo);
+		break;
+	default:
+		break;
+	}
+}
+
+void USLPReplicationGraph::RouteRemoveNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo)
+{
+	switch(GetMappingPolicy(ActorInfo.Actor))
+	{
+	case EClassRepNodeMapping::RelevantAllConnections:
+		AlwaysRelevantNode -> NotifyRemoveNetworkActor(ActorInfo);
+		break;
+	case EClassRepNodeMapping::Spatialize_Static:
+		GridNode -> RemoveActor_Static(ActorInfo);
+		break;
+	case EClassRepNodeMapping::Spatialize_Dynamic:
+		GridNode -> RemoveActor_Dynamic(ActorInfo);
+		break;
+	case EClassRepNodeMapping::Spatialize_Dormancy:
+		GridNode -> RemoveActor_Dormancy(ActorInfo);
+		break;
+	default:
+		break;
+	}
+}
@@ -0,0 +1,56 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ReplicationGraph.h"
+#include "SLPReplicationGraph.generated.h"
+
+// which node an actor class is routed to
+enum class EClassRepNodeMapping : uint8
+{
+	NotRouted,					// handled per connection, the player controller and its view target
+	RelevantAllConnections,		// game state, player states and anything else bAlwaysRelevant
+	Spatialize_Static,			// grid, never moves
+	Spatialize_Dynamic,			// grid, cell updated every frame
+	Spatialize_Dormancy,		// grid, static while dormant and dynamic while awake
+};
+
+/**
+ * Replication graph for SLP, characters go in a spatial grid whose cells scale update frequency by distance to the viewer,
+ * platforms and ladders go in the same grid but are only gathered while awake
+ */
+UCLASS(Transient, Config = Engine)
+class SLP_API USLPReplicationGraph : public UReplicationGraph
+{
+	GENERATED_BODY()
+
+public:
+	virtual void InitGlobalActorClassSettings() override;
+	virtual void InitGlobalGraphNodes() override;
+	virtual void InitConnectionGraphNodes(UNetReplicationGraphConnection* RepGraphConnection) override;
+	virtual void RouteAddNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo, FGlobalActorReplicationInfo& GlobalInfo) override;
+	virtual void RouteRemoveNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo) override;
+
+private:
+	EClassRepNodeMapping GetMappingPolicy(const AActor* Actor);
+
+	UPROPERTY()
+	TObjectPtr<UReplicationGraphNode_GridSpatialization2D> GridNode;
+
+	UPROPERTY()
+	TObjectPtr<UReplicationGraphNode_ActorList> AlwaysRelevantNode;
+
+	TClassMap<EClassRepNodeMapping> ClassRepNodePolicies;
+
+	UPROPERTY(Config)
+	float GridCellSize = 10000.f;
+
+	// world origin offset so every playable location lands in a positive cell
+	UPROPERTY(Config)
+	FVector2D SpatialBias = FVector2D(-200000.f, -200000.f);
+
+	// platforms are replicated further out than characters so riders approaching one see it move
+	UPROPERTY(Config)
+	float PlatformCullDistance = 30000.f;
+};
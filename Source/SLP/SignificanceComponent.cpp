@@ -0,0 +1,32 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SignificanceComponent.h"
+
+#include "SLP.h"
+#include "ActorSignificanceSubsystem.h"
+
+USignificanceComponent::USignificanceComponent()
+{
+	PrimaryComponentTick.bCanEverTick = false;
+}
+
+void USignificanceComponent::BeginPlay()
+{
+	LLM_SCOPE_BYTAG(SLP);
+
+	Super::BeginPlay();
+
+	UActorSignificanceSubsystem* Significance = GetWorld() -> GetSubsystem<UActorSignificanceSubsystem>();
+	if(Significance and bRegisterOnBeginPlay) Significance -> RegisterActor(GetOwner(), bCanDisableTick);
+}
+
+void USignificanceComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if(UActorSignificanceSubsystem* Significance = GetWorld() -> GetSubsystem<UActorSignificanceSubsystem>())
+	{
+		Significance -> UnregisterActor(GetOwner());
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
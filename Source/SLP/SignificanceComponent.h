@@ -0,0 +1,30 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "SignificanceComponent.generated.h"
+
+/**
+ * Registers the owner with UActorSignificanceSubsystem for as long as it plays, so its tick rate follows the distance to the players
+ */
+UCLASS(ClassGroup = (SLP), meta = (BlueprintSpawnableComponent))
+class SLP_API USignificanceComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	USignificanceComponent();
+
+	// false keeps the owner ticking at the lowest rate instead of going dormant
+	UPROPERTY(EditAnywhere, Category = "Significance")
+	bool bCanDisableTick = true;
+
+	// cleared by owners that manage their own tick, read once in BeginPlay
+	bool bRegisterOnBeginPlay = true;
+
+protected:
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+};
@@ -0,0 +1,158 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SimulationCore.h"
+
+#include <algorithm>
+
+namespace SLPCore
+{
+	void FElevatorSim::Reset(bool bStartUp)
+	{
+		State = bStartUp ? EElevatorState::Up : EElevatorState::Down;
+		PreviousState = State;
+		bTriggered = false;
+		ActivationEndTime = -1.0;
+		MoveStartTime = 0.0;
+	}
+
+	void FElevatorSim::Step(double Now, bool bPlayerPresent)
+	{
+		if(IsMoving() and Now >= MoveStartTime + MoveDuration)
+		{
+			PreviousState = State;
+			State = State == EElevatorState::MovingUp ? EElevatorState::Up : EElevatorState::Down;
+			bTriggered = false;
+		}
+
+		if(bPlayerPresent and !bTriggered)
+		{
+			bTriggered = true;
+			ActivationEndTime = Now + ActivationDelay;
+		}
+		if(Now < ActivationEndTime) return;
+
+		switch (State)
+		{
+			case EElevatorState::Down:
+			if(bTriggered)
+			{
+				if(PreviousState == EElevatorState::MovingDown) break;	// if the player stays on the elevator, it won't trigger again
+				MoveStartTime = Now;
+				State = EElevatorState::MovingUp;
+				PreviousState = EElevatorState::Down;
+			}
+			else
+			{
+				PreviousState = State;
+			}
+			break;
+			case EElevatorState::Up:
+			if(bTriggered)
+			{
+				if(PreviousState == EElevatorState::MovingUp) break;
+				MoveStartTime = Now;
+				State = EElevatorState::MovingDown;
+				PreviousState = EElevatorState::Up;
+			}
+			else
+			{
+				PreviousState = State;
+			}
+			break;
+			default:
+				break;
+		}
+	}
+
+	void FElevatorSim::Call(bool bTop, double Now)
+	{
+		if(State != (bTop ? EElevatorState::Down : EElevatorState::Up) or bTriggered) return;
+
+		bTriggered = true;
+		PreviousState = State;	// a new request, not a rider staying on after arriving
+		ActivationEndTime = Now + ActivationDelay;
+	}
+
+	void FElevatorSim::Restore(EElevatorState InState, EElevatorState InPreviousState, bool bInTriggered, double Progress, double Now)
+	{
+		State = InState;
+		PreviousState = InPreviousState;
+		bTriggered = bInTriggered;
+		ActivationEndTime = -1.0;
+		if(IsMoving()) MoveStartTime = Now - Progress * MoveDuration;
+	}
+
+	bool FElevatorSim::IsMoving() const
+	{
+		return State == EElevatorState::MovingUp or State == EElevatorState::MovingDown;
+	}
+
+	double FElevatorSim::GetProgress(double Now) const
+	{
+		if(!IsMoving()) return 0.0;
+		return MoveDuration > 0.0 ? std::clamp((Now - MoveStartTime) / MoveDuration, 0.0, 1.0) : 1.0;
+	}
+
+	double FElevatorSim::GetHeightAlpha(double Now) const
+	{
+		switch (State)
+		{
+			case EElevatorState::Up:			return 1.0;
+			case EElevatorState::MovingUp:		return GetProgress(Now);
+			case EElevatorState::MovingDown:	return 1.0 - GetProgress(Now);
+			default:							return 0.0;
+		}
+	}
+
+	double FElevatorSim::GetNextEventTime(double Now) const
+	{
+		double Next = -1.0;
+		if(Now < ActivationEndTime) Next = ActivationEndTime;
+		if(IsMoving())
+		{
+			const double ArrivalTime = MoveStartTime + MoveDuration;
+			Next = Next < 0.0 ? ArrivalTime : std::min(Next, ArrivalTime);
+		}
+		return Next;
+	}
+
+	float FStaminaSim::Step(float Stamina, const FStaminaRules& Rules, bool bSprinting, double Now, float DeltaTime)
+	{
+		if(bSprinting) return Stamina - Rules.DrainRate * DeltaTime;
+		if(Stamina == Rules.MaxStamina) return Stamina;	// nothing to integrate once rested
+
+		// overspent, clamp and hold regen for a moment
+		if(Stamina < 0.f)
+		{
+			RegenBlockedUntil = Now + Rules.ExhaustedRegenDelay;
+			return 0.f;
+		}
+		if(Now < RegenBlockedUntil) return Stamina;
+		return std::min(Stamina + Rules.RegenRate * DeltaTime, Rules.MaxStamina);
+	}
+
+	bool FRollSim::CanStart(float Stamina, bool bMoving, double Now) const
+	{
+		return Stamina > 0.f and bMoving and !bRolling and Now >= CooldownEndTime;
+	}
+
+	float FRollSim::Start(const FRollRules& Rules, double Now)
+	{
+		bRolling = true;
+		EndTime = Now + Rules.Duration;
+		return Rules.StaminaCost;
+	}
+
+	bool FRollSim::IsFinished(double Now) const
+	{
+		return bRolling and Now >= EndTime;
+	}
+
+	void FRollSim::End(const FRollRules& Rules, double Now)
+	{
+		if(!bRolling) return;
+		bRolling = false;
+		CooldownEndTime = Now + Rules.Cooldown;
+	}
+}
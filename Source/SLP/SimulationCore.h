@@ -0,0 +1,95 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include <cstdint>
+
+/**
+ * Engine independent gameplay rules. The actors keep replication, timers and transforms and call in here for the decisions.
+ * Only the standard library is used, so the rules build and run without the engine.
+ */
+namespace SLPCore
+{
+	enum class EElevatorState : uint8_t
+	{
+		Down,
+		Up,
+		MovingUp,
+		MovingDown
+	};
+
+	// the elevator's trigger, activation delay and move, driven by the server time
+	struct FElevatorSim
+	{
+		EElevatorState State = EElevatorState::Down;
+		EElevatorState PreviousState = EElevatorState::Down;
+		bool bTriggered = false;
+		double ActivationEndTime = -1.0;
+		double MoveStartTime = 0.0;
+
+		double ActivationDelay = 1.0;
+		double MoveDuration = 5.0;
+
+		void Reset(bool bStartUp);
+
+		// one update, a move that has run its course arrives before the trigger is looked at
+		void Step(double Now, bool bPlayerPresent);
+
+		// sends an elevator resting at the other stop to bTop as if a player had stepped on, ignored while it moves or is triggered
+		void Call(bool bTop, double Now);
+
+		// jumps into a saved move, Progress is 0 to 1 through it
+		void Restore(EElevatorState InState, EElevatorState InPreviousState, bool bInTriggered, double Progress, double Now);
+
+		bool IsMoving() const;
+
+		// 0 to 1 through the current move, 0 when resting
+		double GetProgress(double Now) const;
+
+		// 0 at the bottom and 1 at the top
+		double GetHeightAlpha(double Now) const;
+
+		// when Step next has something to do without a player arriving, negative if nothing is pending
+		double GetNextEventTime(double Now) const;
+	};
+
+	struct FStaminaRules
+	{
+		float MaxStamina = 100.f;
+		float RegenRate = 10.f;
+		float DrainRate = 20.f;
+		float ExhaustedRegenDelay = 1.f;	// seconds without regen after going below empty
+	};
+
+	struct FStaminaSim
+	{
+		double RegenBlockedUntil = -1.0;
+
+		// returns the new stamina, drains while sprinting and regens otherwise
+		float Step(float Stamina, const FStaminaRules& Rules, bool bSprinting, double Now, float DeltaTime);
+	};
+
+	struct FRollRules
+	{
+		float StaminaCost = 20.f;
+		float Duration = 0.2f;
+		float Cooldown = 0.2f;
+	};
+
+	struct FRollSim
+	{
+		bool bRolling = false;
+		double EndTime = 0.0;
+		double CooldownEndTime = -1.0;
+
+		bool CanStart(float Stamina, bool bMoving, double Now) const;
+
+		// returns the stamina the roll costs
+		float Start(const FRollRules& Rules, double Now);
+
+		bool IsFinished(double Now) const;
+
+		// the cooldown runs from whenever the roll ended, finished or interrupted
+		void End(const FRollRules& Rules, double Now);
+	};
+}
@@ -3,3 +3,247 @@
 
 #include "TestGameModeBase.h"
 
+#include "SLP.h"
+#include "BaseCharacter.h"
+#include "EngineUtils.h"
+#include "Engine/AssetManager.h"
+#include "Engine/StreamableManager.h"
+#include "GameFramework/PlayerStart.h"
+
+ATestGameModeBase::ATestGameModeBase()
+{
+	PrimaryActorTick.bCanEverTick = true;
+}
+
+void ATestGameModeBase::InitGame(const FString& MapName, const FString& Options, FString& ErrorMessage)
+{
+	LLM_SCOPE_BYTAG(SLP);
+
+	Super::InitGame(MapName, Options, ErrorMessage);
+
+	// start streaming the character assets while the rest of the map loads, the pawn only waits if they are not done by spawn
+	const ABaseCharacter* DefaultCharacter = DefaultPawnClass ? Cast<ABaseCharacter>(DefaultPawnClass -> GetDefaultObject()) : nullptr;
+	if(DefaultCharacter)
+	{
+		CharacterAssetsHandle = UAssetManager::GetStreamableManager().RequestAsyncLoad(
+			DefaultCharacter -> GetCharacterAssetPaths(),
+			FStreamableDelegate(),
+			FStreamableManager::AsyncLoadHighPriority);
+	}
+
+	BuildSpawnIndex();
+}
+
+void ATestGameModeBase::StartPlay()
+{
+	Super::StartPlay();
+
+	// characters placed in the level respawn through the pool like spawned ones
+	for(TActorIterator<ABaseCharacter> It(GetWorld()); It; ++It)
+	{
+		TrackCharacter(*It);
+	}
+}
+
+// Called every frame
+void ATestGameModeBase::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if(!RespawnQueue.IsEmpty()) ProcessRespawns();
+}
+
+APawn* ATestGameModeBase::SpawnDefaultPawnAtTransform_Implementation(AController* NewPlayer, const FTransform& SpawnTransform)
+{
+	UClass* PawnClass = GetDefaultPawnClassForController(NewPlayer);
+
+	// newest first, pooled characters of other classes stay for the controllers that use them
+	for(int32 Index = FreeCharacters.Num() - 1; Index >= 0; --Index)
+	{
+		ABaseCharacter* Character = FreeCharacters[Index].Get();
+		if(!Character)
+		{
+			FreeCharacters.RemoveAtSwap(Index, 1, EAllowShrinking::No);
+			continue;
+		}
+		if(Character -> GetClass() != PawnClass) continue;
+
+		FreeCharacters.RemoveAtSwap(Index, 1, EAllowShrinking::No);
+		Character -> ResetForRespawn(SpawnTransform);
+		Character -> SetPooled(false);
+		return Character;
+	}
+
+	APawn* Pawn = Super::SpawnDefaultPawnAtTransform_Implementation(NewPlayer, SpawnTransform);
+	TrackCharacter(Cast<ABaseCharacter>(Pawn));
+	return Pawn;
+}
+
+AActor* ATestGameModeBase::ChoosePlayerStart_Implementation(AController* Player)
+{
+	if(const FVector* DeathLocation = LastDeathLocations.Find(Player))
+	{
+		const int32 SpawnIndex = FindSpawnPoint(*DeathLocation);
+		if(SpawnIndex != INDEX_NONE and SpawnPoints[SpawnIndex].Start.IsValid()) return SpawnPoints[SpawnIndex].Start.Get();
+	}
+	return Super::ChoosePlayerStart_Implementation(Player);
+}
+
+void ATestGameModeBase::Logout(AController* Exiting)
+{
+	LastDeathLocations.Remove(Exiting);
+
+	Super::Logout(Exiting);
+}
+
+void ATestGameModeBase::TrackCharacter(ABaseCharacter* Character)
+{
+	if(!Character or TrackedCharacters.Contains(Character)) return;
+
+	TrackedCharacters.Add(Character, FTransform(Character -> GetActorRotation(), Character -> GetActorLocation()));
+	Character -> OnDied.AddUObject(this, &ATestGameModeBase::OnCharacterDied);
+	Character -> OnEndPlay.AddDynamic(this, &ATestGameModeBase::OnCharacterEndPlay);
+}
+
+void ATestGameModeBase::OnCharacterEndPlay(AActor* Actor, EEndPlayReason::Type EndPlayReason)
+{
+	TrackedCharacters.Remove(Cast<ABaseCharacter>(Actor));
+}
+
+void ATestGameModeBase::OnCharacterDied(ABaseCharacter* Character)
+{
+	LLM_SCOPE_BYTAG(SLP);
+
+	if(Character -> IsPooled()) return;
+
+	AController* Controller = Character -> GetController();
+	Character -> SetPooled(true);
+
+	if(!Controller)
+	{
+		FreeCharacters.Add(Character);
+		return;
+	}
+
+	// the controller keeps its pawn, the respawn only moves and resets it
+	if(Controller -> IsPlayerController()) LastDeathLocations.Add(Controller, Character -> GetActorLocation());
+	RespawnQueue.Add({ Character, Character -> GetActorLocation(), GetWorld() -> GetTimeSeconds() + RespawnDelay });
+}
+
+void ATestGameModeBase::ProcessRespawns()
+{
+	const double Now = GetWorld() -> GetTimeSeconds();
+	int32 Respawned = 0;
+
+	for(int32 Index = 0; Index < RespawnQueue.Num() and Respawned < MaxRespawnsPerFrame;)
+	{
+		FRespawnRequest& Request = RespawnQueue[Index];
+		ABaseCharacter* Character = Request.Character.Get();
+		if(Character and Request.RespawnTime > Now)
+		{
+			++Index;
+			continue;
+		}
+
+		if(Character)
+		{
+			if(AController* Controller = Character -> GetController())
+			{
+				FTransform SpawnTransform(Character -> GetActorRotation(), Request.DeathLocation);
+				if(Controller -> IsPlayerController())
+				{
+					const int32 SpawnIndex = FindSpawnPoint(Request.DeathLocation);
+					if(SpawnIndex != INDEX_NONE) SpawnTransform = SpawnPoints[SpawnIndex].Transform;
+				}
+				else if(const FTransform* Home = TrackedCharacters.Find(Character))
+				{
+					SpawnTransform = *Home;
+				}
+				Character -> ResetForRespawn(SpawnTransform);
+				Character -> SetPooled(false);
+				++Respawned;
+			}
+			else
+			{
+				FreeCharacters.Add(Character);	// lost its controller while waiting
+			}
+		}
+		RespawnQueue.RemoveAtSwap(Index, 1, EAllowShrinking::No);
+	}
+}
+
+void ATestGameModeBase::BuildSpawnIndex()
+{
+	SpawnPoints.Reset();
+	SpawnGrid.Reset();
+
+	for(TActorIterator<APlayerStart> It(GetWorld()); It; ++It)
+	{
+		const int32 SpawnIndex = SpawnPoints.Num();
+		FSpawnPoint& SpawnPoint = SpawnPoints.AddDefaulted_GetRef();
+		SpawnPoint.Start = *It;
+		SpawnPoint.Transform = FTransform(It -> GetActorRotation(), It -> GetActorLocation());
+		SpawnGrid.FindOrAdd(GetSpawnCell(SpawnPoint.Transform.GetLocation())).Add(SpawnIndex);
+	}
+}
+
+FIntPoint ATestGameModeBase::GetSpawnCell(const FVector& Location) const
+{
+	const float CellSize = FMath::Max(SpawnGridCellSize, 1.f);
+	return FIntPoint(FMath::FloorToInt(Location.X / CellSize), FMath::FloorToInt(Location.Y / CellSize));
+}
+
+int32 ATestGameModeBase::FindSpawnPoint(const FVector& Location)
+{
+	if(SpawnPoints.IsEmpty()) return INDEX_NONE;
+
+	const double Now = GetWorld() -> GetTimeSeconds();
+	const FIntPoint Center = GetSpawnCell(Location);
+
+	// a ring further out can still hold a closer point than the corner of the current one, so search one more ring after a hit
+	int32 BestIndex = INDEX_NONE;
+	double BestDistanceSquared = TNumericLimits<double>::Max();
+	int32 LastRing = TNumericLimits<int32>::Max();
+	const int32 MaxRing = 64;
+
+	for(int32 Ring = 0; Ring <= FMath::Min(LastRing, MaxRing); ++Ring)
+	{
+		for(int32 X = -Ring; X <= Ring; ++X)
+		{
+			for(int32 Y = -Ring; Y <= Ring; ++Y)
+			{
+				if(FMath::Max(FMath::Abs(X), FMath::Abs(Y)) != Ring) continue;	// only the ring's border
+
+				const TArray<int32>* Cell = SpawnGrid.Find(Center + FIntPoint(X, Y));
+				if(!Cell) continue;
+
+				for(const int32 SpawnIndex : *Cell)
+				{
+					const FSpawnPoint& SpawnPoint = SpawnPoints[SpawnIndex];
+					if(Now - SpawnPoint.LastUsedTime < SpawnPointCooldown) continue;
+
+					const double DistanceSquared = FVector::DistSquared(SpawnPoint.Transform.GetLocation(), Location);
+					if(DistanceSquared < BestDistanceSquared)
+					{
+						BestDistanceSquared = DistanceSquared;
+						BestIndex = SpawnIndex;
+					}
+				}
+			}
+		}
+		if(BestIndex != INDEX_NONE and LastRing == TNumericLimits<int32>::Max()) LastRing = Ring + 1;
+	}
+
+	// every point is cooling down, the oldest one is the least likely to still be crowded
+	if(BestIndex == INDEX_NONE)
+	{
+		BestIndex = 0;
+		for(int32 SpawnIndex = 1; SpawnIndex < SpawnPoints.Num(); ++SpawnIndex)
+		{
+			if(SpawnPoints[SpawnIndex].LastUsedTime < SpawnPoints[BestIndex].LastUsedTime) BestIndex = SpawnIndex;
+		}
+	}
+
+	SpawnPoints[BestIndex].LastUsedTime = Now;
+	return BestIndex;
+}
@@ -6,6 +6,9 @@
 #include "GameFramework/GameModeBase.h"
 #include "TestGameModeBase.generated.h"
 
+struct FStreamableHandle;
+class ABaseCharacter;
+
 /**
  * 
  */
@@ -13,5 +16,79 @@ UCLASS()
 class SLP_API ATestGameModeBase : public AGameModeBase
 {
 	GENERATED_BODY()
-	
+
+public:
+	ATestGameModeBase();
+
+	virtual void InitGame(const FString& MapName, const FString& Options, FString& ErrorMessage) override;
+	virtual void StartPlay() override;
+
+	// Called every frame
+	virtual void Tick(float DeltaTime) override;
+
+	// pooled pawns of the right class are reused instead of spawning a new one
+	virtual APawn* SpawnDefaultPawnAtTransform_Implementation(AController* NewPlayer, const FTransform& SpawnTransform) override;
+
+	// starts from the spawn index when the controller died before, otherwise the usual player start search
+	virtual AActor* ChoosePlayerStart_Implementation(AController* Player) override;
+
+	virtual void Logout(AController* Exiting) override;
+
+private:
+	struct FRespawnRequest
+	{
+		TWeakObjectPtr<ABaseCharacter> Character;
+		FVector DeathLocation;
+		double RespawnTime;
+	};
+
+	struct FSpawnPoint
+	{
+		TWeakObjectPtr<AActor> Start;
+		FTransform Transform;
+		double LastUsedTime = -UE_BIG_NUMBER;
+	};
+
+	void TrackCharacter(ABaseCharacter* Character);
+	void OnCharacterDied(ABaseCharacter* Character);
+
+	UFUNCTION()
+	void OnCharacterEndPlay(AActor* Actor, EEndPlayReason::Type EndPlayReason);
+	void ProcessRespawns();
+
+	void BuildSpawnIndex();
+	FIntPoint GetSpawnCell(const FVector& Location) const;
+	// the nearest spawn point to Location that wasn't used within SpawnPointCooldown, searched ring by ring
+	int32 FindSpawnPoint(const FVector& Location);
+
+	// keeps the default pawn's input and animation assets resident for the whole match
+	TSharedPtr<FStreamableHandle> CharacterAssetsHandle;
+
+	// dead characters still possessed, respawned in place once their time comes
+	TArray<FRespawnRequest> RespawnQueue;
+
+	// dead characters whose controller left, handed out by SpawnDefaultPawnAtTransform
+	TArray<TWeakObjectPtr<ABaseCharacter>> FreeCharacters;
+
+	// where each character was first seen, AI respawn there since the player starts are for players
+	TMap<TObjectKey<ABaseCharacter>, FTransform> TrackedCharacters;
+
+	// players only, the death location picks the spawn point
+	TMap<TObjectKey<AController>, FVector> LastDeathLocations;
+
+	TArray<FSpawnPoint> SpawnPoints;
+	TMap<FIntPoint, TArray<int32>> SpawnGrid;
+
+	UPROPERTY(EditAnywhere, Category = "Respawn", meta = (AllowPrivateAccess = "true"))
+	float RespawnDelay = 3.f;
+
+	// respawns past this in one frame wait for the next, so a whole wave doesn't land on the same frame
+	UPROPERTY(EditAnywhere, Category = "Respawn", meta = (AllowPrivateAccess = "true"))
+	int32 MaxRespawnsPerFrame = 4;
+
+	UPROPERTY(EditAnywhere, Category = "Respawn", meta = (AllowPrivateAccess = "true"))
+	float SpawnPointCooldown = 2.f;
+
+	UPROPERTY(EditAnywhere, Category = "Respawn", meta = (AllowPrivateAccess = "true"))
+	float SpawnGridCellSize = 2000.f;
 };
@@ -0,0 +1,131 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TransformHistory.h"
+
+static_assert(FMath::IsPowerOfTwo(FTransformHistory::Capacity), "the ring index is masked");
+
+// 1 mm steps, +-2000 km fits in an int32
+static constexpr double LocationQuantum = 0.1;
+
+void FQuantizedTransform::Set(const FTransform& Transform)
+{
+	const FVector Scaled = Transform.GetLocation() / LocationQuantum;
+	Location = FIntVector(FMath::RoundToInt32(Scaled.X), FMath::RoundToInt32(Scaled.Y), FMath::RoundToInt32(Scaled.Z));
+
+	const FRotator Rotation = Transform.Rotator();
+	Pitch = FRotator::CompressAxisToShort(Rotation.Pitch);
+	Yaw = FRotator::CompressAxisToShort(Rotation.Yaw);
+	Roll = FRotator::CompressAxisToShort(Rotation.Roll);
+}
+
+FVector FQuantizedTransform::GetLocation() const
+{
+	return FVector(Location) * LocationQuantum;
+}
+
+FQuat FQuantizedTransform::GetRotation() const
+{
+	return FRotator(FRotator::DecompressAxisFromShort(Pitch), FRotator::DecompressAxisFromShort(Yaw), FRotator::DecompressAxisFromShort(Roll)).Quaternion();
+}
+
+void FTransformHistory::Reset()
+{
+	Oldest = 0;
+	Count = 0;
+}
+
+void FTransformHistory::Record(double Time, const FTransform& Capsule, TConstArrayView<FTransform> Hitboxes, bool bInvincible)
+{
+	if(Samples.IsEmpty()) Samples.SetNumUninitialized(Capacity);
+
+	int32 Index;
+	if(Count > 0 and Time <= GetNewestTime())
+	{
+		Index = (Oldest + Count - 1) & (Capacity - 1);
+	}
+	else if(Count < Capacity)
+	{
+		Index = (Oldest + Count++) & (Capacity - 1);
+	}
+	else
+	{
+		Index = Oldest;	// full, the oldest sample goes
+		Oldest = (Oldest + 1) & (Capacity - 1);
+	}
+
+	FSample& Sample = Samples[Index];
+	Sample.Time = Time;
+	Sample.Capsule.Set(Capsule);
+	Sample.NumHitboxes = (uint8)FMath::Min(Hitboxes.Num(), MaxHistoryHitboxes);
+	for(int32 i = 0; i < Sample.NumHitboxes; ++i)
+	{
+		Sample.Hitboxes[i].Set(Hitboxes[i]);
+	}
+	Sample.bInvincible = bInvincible;
+}
+
+bool FTransformHistory::Rewind(double Time, FRewoundPose& OutPose) const
+{
+	if(Count == 0) return false;
+
+	if(Time <= GetOldestTime())
+	{
+		Decode(GetSample(0), OutPose);
+		return true;
+	}
+	if(Time >= GetNewestTime())
+	{
+		Decode(GetSample(Count - 1), OutPose);
+		return true;
+	}
+
+	// samples are in time order, find the pair around Time
+	int32 Low = 0;
+	int32 High = Count - 1;
+	while(High - Low > 1)
+	{
+		const int32 Mid = (Low + High) / 2;
+		if(GetSample(Mid).Time <= Time) Low = Mid;
+		else High = Mid;
+	}
+
+	const FSample& A = GetSample(Low);
+	const FSample& B = GetSample(High);
+	const double Alpha = (Time - A.Time) / (B.Time - A.Time);
+
+	OutPose.Capsule = FTransform(FQuat::Slerp(A.Capsule.GetRotation(), B.Capsule.GetRotation(), Alpha), FMath::Lerp(A.Capsule.GetLocation(), B.Capsule.GetLocation(), Alpha));
+	OutPose.NumHitboxes = FMath::Min(A.NumHitboxes, B.NumHitboxes);
+	for(int32 i = 0; i < OutPose.NumHitboxes; ++i)
+	{
+		OutPose.Hitboxes[i] = FTransform(FQuat::Slerp(A.Hitboxes[i].GetRotation(), B.Hitboxes[i].GetRotation(), Alpha), FMath::Lerp(A.Hitboxes[i].GetLocation(), B.Hitboxes[i].GetLocation(), Alpha));
+	}
+	OutPose.bInvincible = (Alpha < 0.5 ? A : B).bInvincible;	// i-frames don't blend, the nearest sample decides
+	return true;
+}
+
+int32 FTransformHistory::Num() const
+{
+	return Count;
+}
+
+double FTransformHistory::GetOldestTime() const
+{
+	return Count > 0 ? GetSample(0).Time : 0.0;
+}
+
+double FTransformHistory::GetNewestTime() const
+{
+	return Count > 0 ? GetSample(Count - 1).Time : 0.0;
+}
+
+void FTransformHistory::Decode(const FSample& Sample, FRewoundPose& OutPose)
+{
+	OutPose.Capsule = FTransform(Sample.Capsule.GetRotation(), Sample.Capsule.GetLocation());
+	OutPose.NumHitboxes = Sample.NumHitboxes;
+	for(int32 i = 0; i < Sample.NumHitboxes; ++i)
+	{
+		OutPose.Hitboxes[i] = FTransform(Sample.Hitboxes[i].GetRotation(), Sample.Hitboxes[i].GetLocation());
+	}
+	OutPose.bInvincible = Sample.bInvincible;
+}
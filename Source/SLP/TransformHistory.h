@@ -0,0 +1,73 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+// hitbox bones recorded per sample, on top of the capsule
+static constexpr int32 MaxHistoryHitboxes = 4;
+
+// world transform at 1 mm and 16 bit angles, scale is dropped
+struct FQuantizedTransform
+{
+	FIntVector Location = FIntVector::ZeroValue;
+	uint16 Pitch = 0;
+	uint16 Yaw = 0;
+	uint16 Roll = 0;
+
+	void Set(const FTransform& Transform);
+	FVector GetLocation() const;
+	FQuat GetRotation() const;
+};
+
+// a character's pose at some past time, filled in place
+struct FRewoundPose
+{
+	FTransform Capsule;
+	FTransform Hitboxes[MaxHistoryHitboxes];
+	int32 NumHitboxes = 0;
+	bool bInvincible = false;
+};
+
+/**
+ * Fixed size ring of quantized character poses, recorded on the server and rewound to validate hits at the time the client saw them
+ */
+class SLP_API FTransformHistory
+{
+public:
+	static constexpr int32 Capacity = 64;	// power of two, a second at 60 samples per second
+
+	void Reset();
+
+	// Time has to increase, a sample at or before the newest one replaces it
+	void Record(double Time, const FTransform& Capsule, TConstArrayView<FTransform> Hitboxes, bool bInvincible);
+
+	// interpolated pose at Time, clamped to the recorded range, false when nothing is recorded
+	bool Rewind(double Time, FRewoundPose& OutPose) const;
+
+	int32 Num() const;
+	double GetOldestTime() const;
+	double GetNewestTime() const;
+
+	SIZE_T GetAllocatedSize() const { return Samples.GetAllocatedSize(); }
+
+private:
+	struct FSample
+	{
+		double Time;
+		FQuantizedTransform Capsule;
+		FQuantizedTransform Hitboxes[MaxHistoryHitboxes];
+		uint8 NumHitboxes;
+		bool bInvincible;
+	};
+
+	// 0 is the oldest sample
+	const FSample& GetSample(int32 Index) const { return Samples[(Oldest + Index) & (Capacity - 1)]; }
+
+	static void Decode(const FSample& Sample, FRewoundPose& OutPose);
+
+	// sized once on the first record, characters that never record don't pay for it
+	TArray<FSample> Samples;
+	int32 Oldest = 0;
+	int32 Count = 0;
+};
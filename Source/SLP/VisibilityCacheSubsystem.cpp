@@ -0,0 +1,164 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VisibilityCacheSubsystem.h"
+
+#include "SLP.h"
+#include "Engine/World.h"
+#include "GameFramework/Actor.h"
+#include "HAL/IConsoleManager.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Visibility Traces"), STAT_VisibilityTraces, STATGROUP_SLP);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Visibility Queue"), STAT_VisibilityQueue, STATGROUP_SLP);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Visibility Cached Pairs"), STAT_VisibilityCachedPairs, STATGROUP_SLP);
+
+static TAutoConsoleVariable<float> CVarVisibilityTimeToLive(
+	TEXT("slp.Visibility.TimeToLive"), 0.2f,
+	TEXT("Seconds a line of sight result is served before it is traced again."));
+
+static TAutoConsoleVariable<int32> CVarVisibilityMaxTracesPerFrame(
+	TEXT("slp.Visibility.MaxTracesPerFrame"), 16,
+	TEXT("Maximum number of line of sight traces started per frame, the rest wait in the queue."));
+
+static TAutoConsoleVariable<float> CVarVisibilityUnusedTimeout(
+	TEXT("slp.Visibility.UnusedTimeout"), 2.f,
+	TEXT("Seconds without a query after which a cached pair is forgotten."));
+
+bool UVisibilityCacheSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game or WorldType == EWorldType::PIE;
+}
+
+TStatId UVisibilityCacheSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UVisibilityCacheSubsystem, STATGROUP_Tickables);
+}
+
+EVisibilityResult UVisibilityCacheSubsystem::QueryVisibility(const AActor* Observer, const AActor* Target)
+{
+	LLM_SCOPE_BYTAG(SLP_AI);
+
+	if(!Observer or !Target) return EVisibilityResult::Unknown;
+
+	const double Now = GetWorld() -> GetTimeSeconds();
+	const FVisibilityKey Key(Observer, Target);
+	FVisibilityEntry& Entry = Entries.FindOrAdd(Key);
+	Entry.LastQueryTime = Now;
+
+	// every consumer asking for this pair shares the one queued trace
+	if(!Entry.bQueued and (!Entry.bHasResult or Now >= Entry.ExpireTime))
+	{
+		Entry.bQueued = true;
+		PendingQueue.Add(Key);
+	}
+
+	if(!Entry.bHasResult) return EVisibilityResult::Unknown;
+	return Entry.bVisible ? EVisibilityResult::Visible : EVisibilityResult::Occluded;
+}
+
+void UVisibilityCacheSubsystem::Tick(float DeltaTime)
+{
+	LLM_SCOPE_BYTAG(SLP_AI);
+
+	Super::Tick(DeltaTime);
+
+	DispatchTraces();
+
+	TimeSincePurge += DeltaTime;
+	if(TimeSincePurge >= CVarVisibilityUnusedTimeout.GetValueOnGameThread())
+	{
+		TimeSincePurge = 0.f;
+		PurgeUnusedEntries();
+	}
+
+	SET_DWORD_STAT(STAT_VisibilityQueue, PendingQueue.Num());
+	SET_DWORD_STAT(STAT_VisibilityCachedPairs, Entries.Num());
+}
+
+void UVisibilityCacheSubsystem::DispatchTraces()
+{
+	if(!TraceDelegate.IsBound()) TraceDelegate.BindUObject(this, &UVisibilityCacheSubsystem::OnTraceCompleted);
+
+	const int32 MaxTraces = CVarVisibilityMaxTracesPerFrame.GetValueOnGameThread();
+	int32 Dispatched = 0;
+	int32 Consumed = 0;
+
+	// oldest requests first, whatever doesn't fit waits for the next frame
+	for(; Consumed < PendingQueue.Num() and Dispatched < MaxTraces; ++Consumed)
+	{
+		const FVisibilityKey& Key = PendingQueue[Consumed];
+		const AActor* Observer = Key.Key.ResolveObjectPtr();
+		const AActor* Target = Key.Value.ResolveObjectPtr();
+		if(!Observer or !Target)
+		{
+			Entries.Remove(Key);
+			continue;
+		}
+
+		FVector EyeLocation;
+		FRotator EyeRotation;
+		Observer -> GetActorEyesViewPoint(EyeLocation, EyeRotation);
+
+		FCollisionQueryParams Params(SCENE_QUERY_STAT(VisibilityCache), false, Observer);
+
+		// characters in the way would stop a single hit trace in front of the wall behind them
+		FCollisionResponseParams ResponseParams;
+		ResponseParams.CollisionResponse.SetResponse(ECC_Pawn, ECR_Ignore);
+
+		const uint32 RequestId = NextRequestId++;
+		InFlight.Add(RequestId, Key);
+		GetWorld() -> AsyncLineTraceByChannel(
+			EAsyncTraceType::Single,
+			EyeLocation,
+			Target -> GetActorLocation(),
+			ECollisionChannel::ECC_GameTraceChannel1,
+			Params,
+			ResponseParams,
+			&TraceDelegate,
+			RequestId
+		);
+		++Dispatched;
+	}
+	PendingQueue.RemoveAt(0, Consumed, EAllowShrinking::No);
+
+	SET_DWORD_STAT(STAT_VisibilityTraces, Dispatched);
+}
+
+void UVisibilityCacheSubsystem::OnTraceCompleted(const FTraceHandle& Handle, FTraceDatum& Datum)
+{
+	LLM_SCOPE_BYTAG(SLP_AI);
+
+	FVisibilityKey Key;
+	if(!InFlight.RemoveAndCopyValue(Datum.UserData, Key)) return;
+
+	FVisibilityEntry* Entry = Entries.Find(Key);
+	if(!Entry) return;	// purged while the trace was running
+
+	// only walls block the sight line, other characters in the way don't
+	const AActor* Target = Key.Value.ResolveObjectPtr();
+	bool bVisible = true;
+	for(const FHitResult& Hit : Datum.OutHits)
+	{
+		const AActor* HitActor = Hit.GetActor();
+		if(HitActor and HitActor != Target and HitActor -> ActorHasTag("IsWall"))
+		{
+			bVisible = false;
+			break;
+		}
+	}
+
+	Entry -> bVisible = bVisible;
+	Entry -> bHasResult = true;
+	Entry -> bQueued = false;
+	Entry -> ExpireTime = GetWorld() -> GetTimeSeconds() + CVarVisibilityTimeToLive.GetValueOnGameThread();
+}
+
+void UVisibilityCacheSubsystem::PurgeUnusedEntries()
+{
+	const double Cutoff = GetWorld() -> GetTimeSeconds() - CVarVisibilityUnusedTimeout.GetValueOnGameThread();
+	for(auto It = Entries.CreateIterator(); It; ++It)
+	{
+		// queued entries stay until their trace comes back
+		if(!It -> Value.bQueued and It -> Value.LastQueryTime < Cutoff) It.RemoveCurrent();
+	}
+}
@@ -0,0 +1,58 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "UObject/ObjectKey.h"
+#include "WorldCollision.h"
+#include "VisibilityCacheSubsystem.generated.h"
+
+enum class EVisibilityResult : uint8
+{
+	Unknown,	// never traced yet, a trace has been queued
+	Visible,
+	Occluded
+};
+
+/**
+ * Caches "can A see B" per observer/target pair and refreshes it with a bounded number of async traces per frame
+ */
+UCLASS()
+class SLP_API UVisibilityCacheSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	// returns the last known result and queues a refresh when it is older than the time to live
+	EVisibilityResult QueryVisibility(const AActor* Observer, const AActor* Target);
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	using FVisibilityKey = TPair<TObjectKey<AActor>, TObjectKey<AActor>>;
+
+	struct FVisibilityEntry
+	{
+		double ExpireTime = 0.0;
+		double LastQueryTime = 0.0;
+		bool bVisible = false;
+		bool bHasResult = false;
+		bool bQueued = false;
+	};
+
+	void DispatchTraces();
+	void PurgeUnusedEntries();
+	void OnTraceCompleted(const FTraceHandle& Handle, FTraceDatum& Datum);
+
+	TMap<FVisibilityKey, FVisibilityEntry> Entries;
+	TArray<FVisibilityKey> PendingQueue;
+	TMap<uint32, FVisibilityKey> InFlight;
+	FTraceDelegate TraceDelegate;
+	uint32 NextRequestId = 0;
+	float TimeSincePurge = 0.f;
+};
@@ -0,0 +1,208 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "WorldSnapshotSubsystem.h"
+
+#include "SLP.h"
+#include "BaseCharacter.h"
+#include "Elevator.h"
+#include "Ladder.h"
+#include "EngineUtils.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/FileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryWriter.h"
+#include "Serialization/MemoryReader.h"
+
+DECLARE_CYCLE_STAT(TEXT("Snapshot Save"), STAT_SnapshotSave, STATGROUP_SLP);
+DECLARE_CYCLE_STAT(TEXT("Snapshot Restore"), STAT_SnapshotRestore, STATGROUP_SLP);
+
+static constexpr uint32 SnapshotMagic = 0x534C5053;	// "SLPS"
+static constexpr uint32 SnapshotVersion = 2;
+
+// one actor's state, keyed by the actor name so the file doesn't depend on object paths
+struct FSnapshotRecord
+{
+	FName Id;
+	TArray<uint8> Payload;
+};
+
+struct FWorldSnapshot
+{
+	TArray<FSnapshotRecord> Characters;
+	TArray<FSnapshotRecord> Elevators;
+	TArray<FSnapshotRecord> Ladders;
+};
+
+// the game thread only copies every actor's state into its own small buffer
+template<typename TActor>
+static void CaptureRecords(TArray<FSnapshotRecord>& Records, UWorld* World)
+{
+	for(TActorIterator<TActor> It(World); It; ++It)
+	{
+		FSnapshotRecord& Record = Records.AddDefaulted_GetRef();
+		Record.Id = It -> GetFName();
+		FMemoryWriter Writer(Record.Payload);
+		It -> SerializeSnapshot(Writer);
+	}
+}
+
+// missing actors are skipped
+template<typename TActor>
+static void ApplyRecords(const TArray<FSnapshotRecord>& Records, UWorld* World)
+{
+	TMap<FName, TActor*> Actors;
+	for(TActorIterator<TActor> It(World); It; ++It)
+	{
+		Actors.Add(It -> GetFName(), *It);
+	}
+
+	for(const FSnapshotRecord& Record : Records)
+	{
+		TActor* Actor = Actors.FindRef(Record.Id);
+		if(!Actor) continue;
+
+		FMemoryReader Reader(Record.Payload);
+		Actor -> SerializeSnapshot(Reader);
+	}
+}
+
+// every record is the actor name and its payload, the memory archives write names as strings
+static void SerializeRecords(FArchive& Ar, TArray<FSnapshotRecord>& Records)
+{
+	int32 Count = Records.Num();
+	Ar << Count;
+	if(Ar.IsLoading())
+	{
+		if(Count < 0)
+		{
+			Ar.SetError();
+			return;
+		}
+		Records.SetNum(Count);
+	}
+
+	for(int32 Index = 0; Index < Count and !Ar.IsError(); ++Index)
+	{
+		Ar << Records[Index].Id << Records[Index].Payload;
+	}
+}
+
+static void SerializeSnapshotFile(FArchive& Ar, FWorldSnapshot& Snapshot)
+{
+	SerializeRecords(Ar, Snapshot.Characters);
+	SerializeRecords(Ar, Snapshot.Elevators);
+	SerializeRecords(Ar, Snapshot.Ladders);
+}
+
+bool UWorldSnapshotSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game or WorldType == EWorldType::PIE;
+}
+
+void UWorldSnapshotSubsystem::Deinitialize()
+{
+	WritePipe.WaitUntilEmpty();
+
+	Super::Deinitialize();
+}
+
+FString UWorldSnapshotSubsystem::GetSnapshotPath(const FString& SlotName)
+{
+	return FPaths::ProjectSavedDir() / TEXT("Snapshots") / SlotName + TEXT(".bin");
+}
+
+bool UWorldSnapshotSubsystem::SaveSnapshot(const FString& SlotName)
+{
+	LLM_SCOPE_BYTAG(SLP);
+
+	SCOPE_CYCLE_COUNTER(STAT_SnapshotSave);
+	if(GetWorld() -> GetNetMode() == NM_Client) return false;	// the server owns the gameplay state
+
+	TSharedRef<FWorldSnapshot, ESPMode::ThreadSafe> Snapshot = MakeShared<FWorldSnapshot, ESPMode::ThreadSafe>();
+	CaptureRecords<ABaseCharacter>(Snapshot -> Characters, GetWorld());
+	CaptureRecords<AElevator>(Snapshot -> Elevators, GetWorld());
+	CaptureRecords<ALadder>(Snapshot -> Ladders, GetWorld());
+
+	Snapshots.Add(SlotName, Snapshot);
+
+	// the snapshot is immutable from here, the pipe builds the blob and replaces the file through a temp so a failed write keeps the old one
+	WritePipe.Launch(TEXT("SaveSnapshot"), [Snapshot, Path = GetSnapshotPath(SlotName)]()
+	{
+		LLM_SCOPE_BYTAG(SLP);
+
+		TArray<uint8> Bytes;
+		FMemoryWriter Ar(Bytes, true);
+		uint32 Magic = SnapshotMagic;
+		uint32 Version = SnapshotVersion;
+		Ar << Magic << Version;
+		SerializeSnapshotFile(Ar, *Snapshot);
+
+		const FString TempPath = Path + TEXT(".tmp");
+		if(!FFileHelper::SaveArrayToFile(Bytes, *TempPath) or !IFileManager::Get().Move(*Path, *TempPath, true, true))
+		{
+			UE_LOG(LogSLP, Warning, TEXT("Failed to write snapshot %s"), *Path);
+		}
+	});
+	return true;
+}
+
+bool UWorldSnapshotSubsystem::RestoreSnapshot(const FString& SlotName)
+{
+	LLM_SCOPE_BYTAG(SLP);
+
+	SCOPE_CYCLE_COUNTER(STAT_SnapshotRestore);
+	if(GetWorld() -> GetNetMode() == NM_Client) return false;
+
+	FSnapshotPtr Snapshot = Snapshots.FindRef(SlotName);
+	if(!Snapshot.IsValid())
+	{
+		TArray<uint8> Bytes;
+		if(!FFileHelper::LoadFileToArray(Bytes, *GetSnapshotPath(SlotName))) return false;
+
+		FMemoryReader Ar(Bytes, true);
+		uint32 Magic = 0;
+		uint32 Version = 0;
+		Ar << Magic << Version;
+		if(Magic != SnapshotMagic or Version != SnapshotVersion)
+		{
+			UE_LOG(LogSLP, Warning, TEXT("Snapshot %s has an unsupported format (version %u)"), *SlotName, Version);
+			return false;
+		}
+
+		TSharedRef<FWorldSnapshot, ESPMode::ThreadSafe> Loaded = MakeShared<FWorldSnapshot, ESPMode::ThreadSafe>();
+		SerializeSnapshotFile(Ar, *Loaded);
+		if(Ar.IsError())
+		{
+			UE_LOG(LogSLP, Warning, TEXT("Snapshot %s is truncated or corrupt"), *SlotName);
+			return false;
+		}
+		Snapshot = Loaded;
+		Snapshots.Add(SlotName, Snapshot);
+	}
+
+	ApplyRecords<ABaseCharacter>(Snapshot -> Characters, GetWorld());
+	ApplyRecords<AElevator>(Snapshot -> Elevators, GetWorld());
+	ApplyRecords<ALadder>(Snapshot -> Ladders, GetWorld());
+	return true;
+}
+
+static FAutoConsoleCommandWithWorldAndArgs SnapshotSaveCommand(
+	TEXT("slp.Snapshot.Save"),
+	TEXT("Saves a snapshot of the world gameplay state. Usage: slp.Snapshot.Save <Slot>"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		UWorldSnapshotSubsystem* Snapshots = World ? World -> GetSubsystem<UWorldSnapshotSubsystem>() : nullptr;
+		if(Snapshots) Snapshots -> SaveSnapshot(Args.IsEmpty() ? TEXT("QuickSave") : Args[0]);
+	}));
+
+static FAutoConsoleCommandWithWorldAndArgs SnapshotRestoreCommand(
+	TEXT("slp.Snapshot.Restore"),
+	TEXT("Restores a snapshot of the world gameplay state. Usage: slp.Snapshot.Restore <Slot>"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		UWorldSnapshotSubsystem* Snapshots = World ? World -> GetSubsystem<UWorldSnapshotSubsystem>() : nullptr;
+		if(Snapshots) Snapshots -> RestoreSnapshot(Args.IsEmpty() ? TEXT("QuickSave") : Args[0]);
+	}));
@@ -0,0 +1,41 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tasks/Pipe.h"
+#include "WorldSnapshotSubsystem.generated.h"
+
+/**
+ * Quick save and checkpoint snapshots of the world gameplay state as a compact versioned binary blob
+ */
+UCLASS()
+class SLP_API UWorldSnapshotSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	// copies the actors' state this frame, the blob is built and written on a background thread
+	UFUNCTION(BlueprintCallable)
+	bool SaveSnapshot(const FString& SlotName);
+
+	// applies the whole snapshot to the live actors in one frame, BeginPlay setup is not run again
+	UFUNCTION(BlueprintCallable)
+	bool RestoreSnapshot(const FString& SlotName);
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	virtual void Deinitialize() override;
+
+private:
+	using FSnapshotPtr = TSharedPtr<const struct FWorldSnapshot, ESPMode::ThreadSafe>;
+
+	static FString GetSnapshotPath(const FString& SlotName);
+
+	// the latest snapshot of every slot, restoring a checkpoint doesn't touch the disk
+	TMap<FString, FSnapshotPtr> Snapshots;
+
+	// writes run one after another, a slot saved twice ends up with the later snapshot
+	UE::Tasks::FPipe WritePipe{ TEXT("WorldSnapshotWrites") };
+};
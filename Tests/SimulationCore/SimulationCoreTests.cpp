@@ -0,0 +1,337 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SimulationCore.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+using namespace SLPCore;
+
+namespace
+{
+	int Failures = 0;
+
+	void Check(bool bCondition, const char* Expression, const char* File, int Line)
+	{
+		if(bCondition) return;
+		++Failures;
+		std::printf("%s:%d: check failed: %s\n", File, Line, Expression);
+	}
+
+	bool Near(double A, double B)
+	{
+		return std::fabs(A - B) < 1e-6;
+	}
+}
+
+#define CHECK(Expression) Check((Expression), #Expression, __FILE__, __LINE__)
+
+// trigger, activation delay, move, arrival
+static void TestElevatorRide()
+{
+	FElevatorSim Sim;
+	Sim.Reset(false);
+	CHECK(Sim.State == EElevatorState::Down);
+	CHECK(Sim.GetNextEventTime(0.0) < 0.0);
+
+	Sim.Step(0.0, false);
+	CHECK(Sim.State == EElevatorState::Down and !Sim.bTriggered);
+
+	// the player steps on, nothing moves until the activation delay is over
+	Sim.Step(10.0, true);
+	CHECK(Sim.bTriggered);
+	CHECK(Sim.State == EElevatorState::Down);
+	CHECK(Near(Sim.GetNextEventTime(10.0), 11.0));
+	Sim.Step(10.5, true);
+	CHECK(Sim.State == EElevatorState::Down);
+
+	Sim.Step(11.0, true);
+	CHECK(Sim.State == EElevatorState::MovingUp);
+	CHECK(Sim.PreviousState == EElevatorState::Down);
+	CHECK(Near(Sim.MoveStartTime, 11.0));
+	CHECK(Near(Sim.GetNextEventTime(11.0), 16.0));
+
+	Sim.Step(13.5, true);
+	CHECK(Sim.State == EElevatorState::MovingUp);
+	CHECK(Near(Sim.GetProgress(13.5), 0.5));
+	CHECK(Near(Sim.GetHeightAlpha(13.5), 0.5));
+
+	// arrives with the player gone
+	Sim.Step(16.0, false);
+	CHECK(Sim.State == EElevatorState::Up);
+	CHECK(Sim.PreviousState == EElevatorState::Up);	// nobody on, so it settles and a new trigger can send it back
+	CHECK(!Sim.bTriggered);
+	CHECK(Near(Sim.GetHeightAlpha(16.0), 1.0));
+	CHECK(Near(Sim.GetProgress(16.0), 0.0));
+	CHECK(Sim.GetNextEventTime(16.0) < 0.0);
+
+	// a late step still arrives, the move never overshoots
+	FElevatorSim Late;
+	Late.Reset(false);
+	Late.Step(0.0, true);
+	Late.Step(1.0, true);
+	CHECK(Near(Late.GetHeightAlpha(100.0), 1.0));
+	Late.Step(100.0, false);
+	CHECK(Late.State == EElevatorState::Up);
+}
+
+// a rider who stays on doesn't send it back, a new trigger does
+static void TestElevatorRetrigger()
+{
+	FElevatorSim Sim;
+	Sim.Reset(false);
+	Sim.Step(0.0, true);
+	Sim.Step(1.0, true);
+	CHECK(Sim.State == EElevatorState::MovingUp);
+
+	// arrives with the player still on, the trigger rearms but the elevator stays
+	Sim.Step(6.0, true);
+	CHECK(Sim.State == EElevatorState::Up);
+	CHECK(Sim.bTriggered);
+	Sim.Step(7.0, true);
+	Sim.Step(20.0, true);
+	CHECK(Sim.State == EElevatorState::Up);
+
+	// the player leaves at the top and the next ride is triggered from there
+	FElevatorSim Top;
+	Top.Reset(false);
+	Top.Step(0.0, true);
+	Top.Step(1.0, true);
+	Top.Step(6.0, false);
+	Top.Step(8.0, false);
+	CHECK(Top.State == EElevatorState::Up);
+	CHECK(Top.PreviousState == EElevatorState::Up);
+
+	Top.Step(9.0, true);
+	CHECK(Top.State == EElevatorState::Up);
+	Top.Step(10.0, true);
+	CHECK(Top.State == EElevatorState::MovingDown);
+	CHECK(Top.PreviousState == EElevatorState::Up);
+	CHECK(Near(Top.GetHeightAlpha(12.5), 0.5));
+	Top.Step(15.0, false);
+	CHECK(Top.State == EElevatorState::Down);
+	CHECK(Near(Top.GetHeightAlpha(15.0), 0.0));
+
+	// starting at the top
+	FElevatorSim Start;
+	Start.Reset(true);
+	CHECK(Start.State == EElevatorState::Up);
+	CHECK(Near(Start.GetHeightAlpha(0.0), 1.0));
+}
+
+// an AI at the other stop calls it over without anyone on
+static void TestElevatorCall()
+{
+	FElevatorSim Sim;
+	Sim.Reset(true);
+	Sim.Call(true, 0.0);
+	CHECK(!Sim.bTriggered);	// already there
+
+	Sim.Call(false, 0.0);
+	CHECK(Sim.bTriggered);
+	CHECK(Near(Sim.GetNextEventTime(0.0), 1.0));
+	Sim.Step(1.0, false);
+	CHECK(Sim.State == EElevatorState::MovingDown);
+
+	// ignored while moving, the caller asks again once it rests
+	Sim.Call(true, 2.0);
+	Sim.Step(6.0, false);
+	CHECK(Sim.State == EElevatorState::Down);
+	CHECK(!Sim.bTriggered);
+
+	// right after arriving, before it has settled
+	Sim.Call(true, 6.0);
+	CHECK(Sim.bTriggered);
+	Sim.Step(7.0, false);
+	CHECK(Sim.State == EElevatorState::MovingUp);
+
+	// a rider who stayed on keeps it where it is
+	FElevatorSim Occupied;
+	Occupied.Reset(false);
+	Occupied.Step(0.0, true);
+	Occupied.Step(1.0, true);
+	Occupied.Step(6.0, true);
+	Occupied.Call(false, 6.0);
+	Occupied.Step(8.0, true);
+	CHECK(Occupied.State == EElevatorState::Up);
+}
+
+static void TestElevatorRestore()
+{
+	FElevatorSim Sim;
+	Sim.Reset(false);
+	Sim.Restore(EElevatorState::MovingDown, EElevatorState::Up, true, 0.25, 100.0);
+	CHECK(Sim.IsMoving());
+	CHECK(Near(Sim.GetProgress(100.0), 0.25));
+	CHECK(Near(Sim.GetHeightAlpha(100.0), 0.75));
+	CHECK(Near(Sim.GetNextEventTime(100.0), 103.75));
+
+	Sim.Step(103.75, false);
+	CHECK(Sim.State == EElevatorState::Down);
+}
+
+static void TestStamina()
+{
+	const FStaminaRules Rules;
+	FStaminaSim Sim;
+
+	// drains while sprinting
+	float Stamina = Sim.Step(Rules.MaxStamina, Rules, true, 0.0, 1.f);
+	CHECK(Near(Stamina, Rules.MaxStamina - Rules.DrainRate));
+
+	// regens otherwise and stops at the max
+	Stamina = Sim.Step(50.f, Rules, false, 0.0, 1.f);
+	CHECK(Near(Stamina, 50.f + Rules.RegenRate));
+	Stamina = Sim.Step(Rules.MaxStamina - 1.f, Rules, false, 0.0, 1.f);
+	CHECK(Near(Stamina, Rules.MaxStamina));
+	CHECK(Near(Sim.Step(Rules.MaxStamina, Rules, false, 0.0, 1.f), Rules.MaxStamina));
+
+	// overspent, clamps to empty and holds regen for the exhausted delay
+	Stamina = Sim.Step(5.f, Rules, true, 10.0, 1.f);
+	CHECK(Stamina < 0.f);
+	Stamina = Sim.Step(Stamina, Rules, false, 10.0, 0.1f);
+	CHECK(Near(Stamina, 0.0));
+	CHECK(Near(Sim.RegenBlockedUntil, 10.0 + Rules.ExhaustedRegenDelay));
+	CHECK(Near(Sim.Step(Stamina, Rules, false, 10.5, 0.1f), 0.0));
+	CHECK(Near(Sim.Step(Stamina, Rules, false, 10.99, 0.1f), 0.0));
+
+	Stamina = Sim.Step(Stamina, Rules, false, 11.0, 0.5f);
+	CHECK(Near(Stamina, Rules.RegenRate * 0.5f));
+}
+
+static void TestRoll()
+{
+	const FRollRules Rules;
+	FRollSim Sim;
+
+	// needs stamina and movement
+	CHECK(!Sim.CanStart(0.f, true, 0.0));
+	CHECK(!Sim.CanStart(50.f, false, 0.0));
+	CHECK(Sim.CanStart(50.f, true, 0.0));
+
+	CHECK(Near(Sim.Start(Rules, 1.0), Rules.StaminaCost));
+	CHECK(Sim.bRolling);
+	CHECK(!Sim.CanStart(50.f, true, 1.0));
+
+	// runs for the duration
+	CHECK(!Sim.IsFinished(1.0 + Rules.Duration * 0.5));
+	CHECK(Sim.IsFinished(1.0 + Rules.Duration));
+
+	// then the cooldown from whenever it ended
+	const double EndTime = 1.0 + Rules.Duration;
+	Sim.End(Rules, EndTime);
+	CHECK(!Sim.bRolling);
+	CHECK(!Sim.IsFinished(EndTime));
+	CHECK(!Sim.CanStart(50.f, true, EndTime + Rules.Cooldown * 0.5));
+	CHECK(Sim.CanStart(50.f, true, EndTime + Rules.Cooldown));
+
+	// ending twice doesn't push the cooldown out
+	Sim.End(Rules, EndTime + 10.0);
+	CHECK(Sim.CanStart(50.f, true, EndTime + Rules.Cooldown));
+
+	// an interrupted roll cools down from the interruption
+	FRollSim Interrupted;
+	Interrupted.Start(Rules, 0.0);
+	Interrupted.End(Rules, 0.05);
+	CHECK(!Interrupted.CanStart(50.f, true, 0.05 + Rules.Cooldown * 0.5));
+	CHECK(Interrupted.CanStart(50.f, true, 0.05 + Rules.Cooldown));
+}
+
+// keeps the optimizer from dropping the loops
+static volatile double Sink = 0.0;
+
+template<typename FunctionType>
+static void Bench(const char* Name, int Iterations, FunctionType&& Function)
+{
+	const auto Start = std::chrono::steady_clock::now();
+	Function(Iterations);
+	const auto End = std::chrono::steady_clock::now();
+	const double Nanoseconds = std::chrono::duration<double, std::nano>(End - Start).count();
+	std::printf("%-24s %10d iterations  %8.2f ns/iter  %8.3f ms\n", Name, Iterations, Nanoseconds / Iterations, Nanoseconds / 1e6);
+}
+
+static void RunBenchmarks()
+{
+	constexpr int Iterations = 10000000;
+	constexpr double Step = 1.0 / 60.0;
+
+	Bench("ElevatorSim::Step", Iterations, [=](int Count)
+	{
+		FElevatorSim Sim;
+		Sim.Reset(false);
+		double Now = 0.0;
+		for(int i = 0; i < Count; ++i)
+		{
+			Now += Step;
+			Sim.Step(Now, (i & 511) < 64);	// a rider on for a few frames now and then
+			Sink = Sink + Sim.GetHeightAlpha(Now);
+		}
+	});
+
+	Bench("ElevatorSim::NextEvent", Iterations, [=](int Count)
+	{
+		FElevatorSim Sim;
+		Sim.Reset(false);
+		Sim.Step(0.0, true);
+		Sim.Step(1.0, true);
+		double Now = 1.0;
+		for(int i = 0; i < Count; ++i)
+		{
+			Now += 1e-7;
+			Sink = Sink + Sim.GetNextEventTime(Now);
+		}
+	});
+
+	Bench("StaminaSim::Step", Iterations, [=](int Count)
+	{
+		const FStaminaRules Rules;
+		FStaminaSim Sim;
+		float Stamina = Rules.MaxStamina;
+		double Now = 0.0;
+		for(int i = 0; i < Count; ++i)
+		{
+			Now += Step;
+			Stamina = Sim.Step(Stamina, Rules, (i & 1023) < 400, Now, (float)Step);
+		}
+		Sink = Sink + Stamina;
+	});
+
+	Bench("RollSim", Iterations, [=](int Count)
+	{
+		const FRollRules Rules;
+		FRollSim Sim;
+		float Stamina = 100.f;
+		double Now = 0.0;
+		for(int i = 0; i < Count; ++i)
+		{
+			Now += Step;
+			if(Sim.IsFinished(Now)) Sim.End(Rules, Now);
+			if(Sim.CanStart(Stamina, true, Now)) Stamina -= Sim.Start(Rules, Now);
+			if(Stamina < 20.f) Stamina = 100.f;
+		}
+		Sink = Sink + Stamina;
+	});
+}
+
+int main(int ArgCount, char** Args)
+{
+	TestElevatorRide();
+	TestElevatorRetrigger();
+	TestElevatorCall();
+	TestElevatorRestore();
+	TestStamina();
+	TestRoll();
+
+	if(Failures > 0)
+	{
+		std::printf("%d check(s) failed\n", Failures);
+		return 1;
+	}
+	std::printf("all checks passed\n");
+
+	if(ArgCount > 1 and std::strcmp(Args[1], "--bench") == 0) RunBenchmarks();
+	return 0;
+}